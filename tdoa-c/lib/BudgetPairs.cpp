@@ -0,0 +1,585 @@
+#include "BudgetPairs.h"
+#include "FilterIQ.h"
+#include "FFT.h"
+#include "SmoothCorr.h"
+#include "CorrReliability.h"
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <memory>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+  const size_t CHUNK = 16384;       // samples per file read
+  const size_t MIN_FFT_LEN = 4096;
+  const size_t MAX_FFT_LEN = 1 << 20;
+  const size_t SLACK = 256 * 1024;  // small buffers (filter taps, peak refinement, ...)
+  const size_t MAX_TAPS = 128;      // longest filter of filter_iq has 102 taps
+
+  // prepared values (filter_iq + abs/dphase as in tdoa2_prepare_slice) of one slice, read in chunks
+  class SliceReader
+  {
+  public:
+    explicit SliceReader(MemoryBudget &budget)
+        : bytes_(BudgetAllocator<uint8_t>(budget)), iq_(BudgetAllocator<std::complex<float>>(budget)),
+          filtered_(BudgetAllocator<std::complex<float>>(budget))
+    {
+    }
+
+    int open(const std::string &filename, const Tdoa2Config &config, int k)
+    {
+      const SliceLayout &layout = config.layout;
+      file_.close();
+      file_.clear();
+      file_.open(filename, std::ios::binary);
+      if (!file_.is_open())
+      {
+        std::cerr << "Error: file " << filename << " cannot be opened!" << std::endl;
+        return 1;
+      }
+      file_.seekg(0, std::ios::end);
+      if (static_cast<size_t>(file_.tellg()) != 2 * layout.total())
+      {
+        std::cerr << "Error: Length of Signal is unequal " << layout.total() << " (" << filename << ")" << std::endl;
+        return 1;
+      }
+      file_.seekg(static_cast<std::streamoff>(2 * layout.slice_start(k)));
+
+      corr_type_ = config.corr_type;
+      int bandwidth_khz = k == 1 ? config.signal_bandwidth_khz : config.ref_bandwidth_khz;
+      taps_ = bandwidth_khz != 0 ? get_filter_coeffs(bandwidth_khz) : std::vector<float>();
+      if (bandwidth_khz != 0 && taps_.empty())
+        std::cout << "no filtering performed!" << std::endl;
+      history_ = taps_.empty() ? 0 : taps_.size() - 1;
+
+      // zero initial filter state
+      bytes_.resize(2 * CHUNK);
+      iq_.assign(history_ + CHUNK, std::complex<float>(0.0f, 0.0f));
+      if (!taps_.empty())
+        filtered_.resize(history_ + CHUNK);
+      remaining_ = layout.samples_per_slice;
+      first_ = true;
+      return 0;
+    }
+
+    int read(double *out, size_t count)
+    {
+      if (count > remaining_)
+      {
+        std::cerr << "Error: read beyond the slice!" << std::endl;
+        return 1;
+      }
+      remaining_ -= count;
+      while (count > 0)
+      {
+        size_t c = std::min(CHUNK, count);
+        if (!file_.read(reinterpret_cast<char *>(bytes_.data()), static_cast<std::streamsize>(2 * c)))
+        {
+          std::cerr << "Error: capture file cannot be read!" << std::endl;
+          return 1;
+        }
+        std::complex<float> *x = iq_.data() + history_;
+        for (size_t i = 0; i < c; ++i)
+          x[i] = std::complex<float>(static_cast<float>(bytes_[2 * i]) - 128.0f, static_cast<float>(bytes_[2 * i + 1]) - 128.0f);
+
+        // the outputs of the history part are discarded, the last inputs are the next history
+        const std::complex<float> *y = x;
+        if (!taps_.empty())
+        {
+          fir_filter(iq_.data(), history_ + c, taps_, filtered_.data());
+          y = filtered_.data() + history_;
+        }
+
+        // prepare_iq on a stream
+        if (corr_type_ == CORR_ABS)
+          for (size_t i = 0; i < c; ++i)
+            out[i] = std::abs(y[i]);
+        else
+          for (size_t i = 0; i < c; ++i)
+          {
+            double phase = std::arg(y[i]);
+            double d = first_ ? 0.0 : phase - phase_old_;
+            if (d > M_PI)
+              d -= 2.0 * M_PI;
+            else if (d < -M_PI)
+              d += 2.0 * M_PI;
+            phase_old_ = phase;
+            first_ = false;
+            out[i] = d;
+          }
+        if (history_)
+          std::memmove(iq_.data(), iq_.data() + c, history_ * sizeof(std::complex<float>));
+        out += c;
+        count -= c;
+      }
+      return 0;
+    }
+
+  private:
+    std::ifstream file_;
+    CorrType corr_type_ = CORR_DPHASE;
+    std::vector<float> taps_; // empty: no filter
+    size_t history_ = 0;      // taps - 1
+    BudgetVector<uint8_t> bytes_;
+    BudgetVector<std::complex<float>> iq_; // history + chunk
+    BudgetVector<std::complex<float>> filtered_;
+    size_t remaining_ = 0;
+    bool first_ = true;
+    double phase_old_ = 0.0;
+  };
+
+  size_t reader_bytes()
+  {
+    return 2 * CHUNK + 2 * (CHUNK + MAX_TAPS) * sizeof(std::complex<float>);
+  }
+
+  // values of one slice with the mean removed, read in order from the start of the slice
+  class Source
+  {
+  public:
+    virtual ~Source() = default;
+    // back to the first value
+    virtual int rewind() = 0;
+    // the next count values (no more than are left)
+    virtual int read(double *out, size_t count) = 0;
+  };
+
+  // slice prepared in memory
+  class ResidentSource : public Source
+  {
+  public:
+    ResidentSource(const BudgetVector<double> &seq, double mean) : seq_(seq), mean_(mean) {}
+
+    int rewind() override
+    {
+      pos_ = 0;
+      return 0;
+    }
+
+    int read(double *out, size_t count) override
+    {
+      for (size_t i = 0; i < count; ++i)
+        out[i] = seq_[pos_ + i] - mean_;
+      pos_ += count;
+      return 0;
+    }
+
+  private:
+    const BudgetVector<double> &seq_;
+    double mean_;
+    size_t pos_ = 0;
+  };
+
+  // slice prepared from the file again on every pass
+  class StreamedSource : public Source
+  {
+  public:
+    StreamedSource(MemoryBudget &budget, const std::string &filename, const Tdoa2Config &config, int k, double mean)
+        : reader_(budget), filename_(filename), config_(config), k_(k), mean_(mean)
+    {
+    }
+
+    int rewind() override { return reader_.open(filename_, config_, k_); }
+
+    int read(double *out, size_t count) override
+    {
+      if (reader_.read(out, count))
+        return 1;
+      for (size_t i = 0; i < count; ++i)
+        out[i] -= mean_;
+      return 0;
+    }
+
+  private:
+    SliceReader reader_;
+    const std::string &filename_;
+    const Tdoa2Config &config_;
+    int k_;
+    double mean_;
+  };
+
+  // fft buffer, half spectrum accumulator, sliding window of a, block of b (the fft tables are charged separately)
+  size_t block_xcorr_bytes(size_t fft_len)
+  {
+    return fft_len * (sizeof(std::complex<double>) + sizeof(std::complex<double>) / 2 + 2 * sizeof(double));
+  }
+
+  // twiddle and permutation tables of FFTPlan (FFTPlan::bytes)
+  size_t fft_table_bytes(size_t fft_len)
+  {
+    return 32 * fft_len;
+  }
+
+  // raw xcorr(a - mean_a, b - mean_b) for lags lo..hi (corr[0] = lag lo) of two slices of n values
+  // overlap-save: every block of B = fft_len - W + 1 values of b is correlated with the W + B - 1 values
+  // of a it overlaps at these W lags, the cross spectra are summed and transformed back once
+  // windows wider than fft_len / 2 take several passes over the sources (W = fft_len / 2 lags each)
+  int block_xcorr(Source &a, Source &b, long n, long lo, long hi, size_t fft_len, MemoryBudget &budget,
+                  std::vector<double> &corr, double &peak)
+  {
+    TraceSpan span("block xcorr");
+    const long P = static_cast<long>(fft_len);
+    if (lo > hi || lo <= -n || hi >= n || P < 2)
+    {
+      std::cerr << "Error: invalid lag window for block correlation!" << std::endl;
+      return 1;
+    }
+    const FFTPlan &plan = get_fft_plan(fft_len);
+    BudgetVector<std::complex<double>> z(fft_len, BudgetAllocator<std::complex<double>>(budget));
+    BudgetVector<std::complex<double>> acc(fft_len / 2 + 1, BudgetAllocator<std::complex<double>>(budget));
+    BudgetVector<double> a_win(fft_len, BudgetAllocator<double>(budget));
+    BudgetVector<double> b_blk(fft_len, BudgetAllocator<double>(budget));
+    corr.resize(static_cast<size_t>(hi - lo + 1));
+    peak = -std::numeric_limits<double>::infinity();
+
+    for (long pass_lo = lo; pass_lo <= hi; pass_lo += P / 2)
+    {
+      const long W = std::min(hi - pass_lo + 1, P / 2);
+      const long B = P - W + 1;
+      if (a.rewind() || b.rewind())
+        return 1;
+      std::fill(acc.begin(), acc.end(), std::complex<double>(0.0, 0.0));
+
+      // a values from index a_next on, zero outside 0..n-1
+      long a_next = pass_lo;
+      auto pull_a = [&](double *out, long count)
+      {
+        long zeros = std::clamp(-a_next, 0L, count);
+        long real = std::clamp(n - std::max(a_next, 0L), 0L, count - zeros);
+        std::fill(out, out + zeros, 0.0);
+        if (real > 0 && a.read(out + zeros, static_cast<size_t>(real)))
+          return 1;
+        std::fill(out + zeros + real, out + count, 0.0);
+        a_next += count;
+        return 0;
+      };
+      // lags > 0 skip the first values of a
+      for (long skip = pass_lo; skip > 0;)
+      {
+        long c = std::min(skip, P);
+        if (a.read(a_win.data(), static_cast<size_t>(c)))
+          return 1;
+        skip -= c;
+      }
+
+      for (long k0 = 0; k0 < n; k0 += B)
+      {
+        if (k0 == 0)
+        {
+          if (pull_a(a_win.data(), P))
+            return 1;
+        }
+        else
+        {
+          std::memmove(a_win.data(), a_win.data() + B, static_cast<size_t>(W - 1) * sizeof(double));
+          if (pull_a(a_win.data() + W - 1, B))
+            return 1;
+        }
+        long count = std::min(B, n - k0);
+        if (b.read(b_blk.data(), static_cast<size_t>(count)))
+          return 1;
+
+        // both real blocks in one complex fft, cross spectrum A[k] * B*[k] as in cross_spectrum
+        for (long j = 0; j < P; ++j)
+          z[j] = std::complex<double>(a_win[j], j < count ? b_blk[j] : 0.0);
+        plan.forward(z.data());
+        for (size_t k = 0; k <= fft_len / 2; ++k)
+        {
+          size_t kn = (fft_len - k) & (fft_len - 1);
+          std::complex<double> zk = z[k], zn = std::conj(z[kn]);
+          std::complex<double> ak = 0.5 * (zk + zn);
+          std::complex<double> bk = std::complex<double>(0.0, -0.5) * (zk - zn);
+          acc[k] += ak * std::conj(bk);
+        }
+      }
+
+      // hermitian sum back to the full spectrum, lag pass_lo + m at index m
+      for (size_t k = 0; k <= fft_len / 2; ++k)
+      {
+        z[k] = acc[k];
+        z[(fft_len - k) & (fft_len - 1)] = std::conj(acc[k]);
+      }
+      plan.inverse(z.data());
+      double *out = corr.data() + (pass_lo - lo);
+      for (long m = 0; m < W; ++m)
+      {
+        out[m] = z[m].real();
+        peak = std::max(peak, out[m]);
+      }
+    }
+    return 0;
+  }
+
+  // single pass blocks of 3/4 of the fft length (up to MAX_FFT_LEN), no longer than a slice needs
+  size_t preferred_fft_len(size_t W, size_t n)
+  {
+    return std::max(MIN_FFT_LEN, std::min({MAX_FFT_LEN, next_pow2(4 * W), next_pow2(n + W)}));
+  }
+
+  // widest valid window of the jobs (plus the smoothing margins)
+  size_t measure_window(const Tdoa2Config &config, const std::vector<RxPairJob> &jobs)
+  {
+    const long n = static_cast<long>(config.layout.samples_per_slice);
+    long half_span = config.smoothing_factor > 0 ? (config.smoothing_factor - 1) / 2 : 0;
+    size_t widest = 1;
+    for (const RxPairJob &job : jobs)
+    {
+      ValidWindow valid = tdoa2_valid_window(static_cast<size_t>(n - 1), n, job.rx_distance_diff, job.rx_distance,
+                                             config.layout.sample_rate);
+      widest = std::max(widest, static_cast<size_t>(valid.hi - valid.lo + 1 + 2 * half_span));
+    }
+    return widest;
+  }
+
+  size_t plan_bytes(BudgetStrategy strategy, size_t num_rx, size_t n, size_t ref_len, size_t ref_w,
+                    size_t measure_len, size_t measure_w)
+  {
+    size_t resident = strategy == BUDGET_RESIDENT ? num_rx * n * sizeof(double) : 0;
+    size_t readers = (strategy == BUDGET_RESIDENT ? 1 : 2) * reader_bytes() + CHUNK * sizeof(double);
+    size_t tables = fft_table_bytes(ref_len) + (measure_len != ref_len ? fft_table_bytes(measure_len) : 0);
+    // raw and normalized (smoothed) window
+    size_t ref = block_xcorr_bytes(ref_len) + 2 * ref_w * sizeof(double);
+    size_t measure = block_xcorr_bytes(measure_len) + 4 * measure_w * sizeof(double);
+    return resident + readers + tables + std::max(ref, measure) + SLACK;
+  }
+
+  struct RefWindow
+  {
+    double delay;
+    double reliability;
+    size_t idx; // index of the peak in the full correlation (lag + n - 1)
+  };
+
+  // tdoa2_ref_corr + tdoa2_peak_delay on the lags -max_lag..max_lag
+  int ref_window(Source &a, Source &b, long n, long max_lag, const Tdoa2Config &config, size_t fft_len,
+                 MemoryBudget &budget, RefWindow &ref)
+  {
+    const size_t W = static_cast<size_t>(2 * max_lag + 1);
+    BudgetReservation windows(budget, 2 * W * sizeof(double));
+    std::vector<double> corr;
+    double peak;
+    if (block_xcorr(a, b, n, -max_lag, max_lag, fft_len, budget, corr, peak))
+      return 1;
+
+    // correlate_iq_finish: smoothing or normalization to the peak
+    if (config.smoothing_factor_ref != 0)
+    {
+      std::vector<double> smoothed;
+      double corr_max;
+      if (smooth_corr(corr, config.smoothing_factor_ref, smoothed, corr_max))
+        return 1;
+      corr.swap(smoothed);
+    }
+    else if (peak != 0.0)
+      for (double &v : corr)
+        v /= peak;
+
+    ref.reliability = corr_reliability(corr);
+    size_t idx = std::max_element(corr.begin(), corr.end()) - corr.begin();
+    long idx_offset = n - 1 - max_lag;
+    double interp;
+    if (tdoa2_peak_delay(corr, idx, idx_offset, n, config.interpol, ref.delay, interp))
+      return 1;
+    if (config.interpol > 1)
+      ref.delay = interp;
+    ref.idx = static_cast<size_t>(idx_offset) + idx;
+    return 0;
+  }
+}
+
+int budget_plan(const Tdoa2Config &config, size_t num_rx, const std::vector<RxPairJob> &jobs, long ref_max_lag,
+                size_t budget_bytes, BudgetPlan &plan)
+{
+  const size_t n = config.layout.samples_per_slice;
+  const size_t ref_w = static_cast<size_t>(2 * std::clamp(ref_max_lag, 0L, static_cast<long>(n) - 1) + 1);
+  const size_t measure_w = measure_window(config, jobs);
+  const size_t measure_len = preferred_fft_len(measure_w, n);
+  std::vector<bool> used(num_rx, false);
+  for (const RxPairJob &job : jobs)
+    if (job.rx1 < num_rx && job.rx2 < num_rx)
+      used[job.rx1] = used[job.rx2] = true;
+  const size_t num_used = std::count(used.begin(), used.end(), true);
+
+  for (BudgetStrategy strategy : {BUDGET_RESIDENT, BUDGET_STREAMED})
+    for (size_t len = preferred_fft_len(ref_w, n); len >= MIN_FFT_LEN; len /= 2)
+    {
+      // the measurement blocks shrink along with the reference blocks
+      size_t m_len = std::min(measure_len, len);
+      plan = {strategy, len, m_len, plan_bytes(strategy, num_used, n, len, ref_w, m_len, measure_w)};
+      if (plan.estimate <= budget_bytes)
+        return 0;
+    }
+  return 1;
+}
+
+int tdoa2_pairs_budgeted(const std::vector<std::string> &files, const Tdoa2Config &config, long ref_max_lag,
+                         const BudgetPlan &plan, std::vector<RxPairJob> &jobs, MemoryBudget &budget)
+{
+  const long n = static_cast<long>(config.layout.samples_per_slice);
+  const long max_lag = std::clamp(ref_max_lag, 0L, n - 1);
+  if (!tdoa2_full_ref(config))
+  {
+    std::cerr << "Error: the budgeted engine has no welch, coarse-fine or DAB correlation (corr_segment_len, corr_mode)!" << std::endl;
+    return 1;
+  }
+  if (config.drift_compensation == DRIFT_RESAMPLE)
+  {
+    std::cerr << "Error: the budgeted engine does not resample the measurement slices (drift_compensation)!" << std::endl;
+    return 1;
+  }
+  if (config.measure_template)
+  {
+    std::cerr << "Error: the budgeted engine has no matched filter measurement (template_file)!" << std::endl;
+    return 1;
+  }
+  std::vector<bool> used(files.size(), false);
+  for (RxPairJob &job : jobs)
+  {
+    job.ok = false;
+    if (job.rx1 >= files.size() || job.rx2 >= files.size() || job.rx1 == job.rx2)
+    {
+      std::cerr << "Error: invalid receiver pair " << job.rx1 + 1 << " & " << job.rx2 + 1 << std::endl;
+      return 1;
+    }
+    used[job.rx1] = used[job.rx2] = true;
+  }
+
+  try
+  {
+    // the fft tables live as long as the process, they count for the whole run
+    BudgetReservation ref_tables(budget, get_fft_plan(plan.ref_fft_len).bytes());
+    BudgetReservation measure_tables(budget, plan.measure_fft_len != plan.ref_fft_len ? get_fft_plan(plan.measure_fft_len).bytes() : 0);
+
+    // slice by slice: both references of every pair, then the measurement in the valid window of ref 1
+    std::vector<RefWindow> ref1(jobs.size()), ref3(jobs.size());
+    std::vector<bool> pair_ok(jobs.size(), true);
+    for (int k : {0, 2, 1})
+    {
+      // means (and in the resident plan the sequences) of slice k of every used receiver
+      std::vector<double> mean(files.size(), 0.0);
+      std::vector<BudgetVector<double>> seq;
+      for (size_t rx = 0; rx < files.size(); ++rx)
+        seq.emplace_back(BudgetAllocator<double>(budget));
+      {
+        TraceSpan span("prepare slice");
+        SliceReader reader(budget);
+        BudgetVector<double> chunk{BudgetAllocator<double>(budget)};
+        if (plan.strategy == BUDGET_STREAMED)
+          chunk.resize(CHUNK);
+        for (size_t rx = 0; rx < files.size(); ++rx)
+        {
+          if (!used[rx])
+            continue;
+          if (reader.open(files[rx], config, k))
+            return 1;
+          double sum = 0.0;
+          if (plan.strategy == BUDGET_RESIDENT)
+          {
+            seq[rx].resize(static_cast<size_t>(n));
+            if (reader.read(seq[rx].data(), seq[rx].size()))
+              return 1;
+            for (double v : seq[rx])
+              sum += v;
+          }
+          else
+            for (long done = 0; done < n; done += static_cast<long>(chunk.size()))
+            {
+              size_t c = std::min(chunk.size(), static_cast<size_t>(n - done));
+              if (reader.read(chunk.data(), c))
+                return 1;
+              for (size_t i = 0; i < c; ++i)
+                sum += chunk[i];
+            }
+          mean[rx] = sum / static_cast<double>(n);
+        }
+      }
+
+      for (size_t j = 0; j < jobs.size(); ++j)
+      {
+        if (!pair_ok[j])
+          continue;
+        const RxPairJob &job = jobs[j];
+
+        // sources with the mean removed, from memory or from the files
+        std::unique_ptr<Source> a, b;
+        if (plan.strategy == BUDGET_RESIDENT)
+        {
+          a = std::make_unique<ResidentSource>(seq[job.rx1], mean[job.rx1]);
+          b = std::make_unique<ResidentSource>(seq[job.rx2], mean[job.rx2]);
+        }
+        else
+        {
+          a = std::make_unique<StreamedSource>(budget, files[job.rx1], config, k, mean[job.rx1]);
+          b = std::make_unique<StreamedSource>(budget, files[job.rx2], config, k, mean[job.rx2]);
+        }
+
+        if (k != 1)
+        {
+          if (ref_window(*a, *b, n, max_lag, config, plan.ref_fft_len, budget, k == 0 ? ref1[j] : ref3[j]))
+            pair_ok[j] = false;
+          continue;
+        }
+
+        // measurement slice in the valid window around the reference peak (tdoa2_measure_raw)
+        ValidWindow valid = tdoa2_valid_window(ref1[j].idx, n, job.rx_distance_diff, job.rx_distance, config.layout.sample_rate);
+        long half_span = config.smoothing_factor > 0 ? (config.smoothing_factor - 1) / 2 : 0;
+        long win_lo = std::max(0L, valid.lo - half_span);
+        long win_hi = std::min(2 * n - 2, valid.hi + half_span);
+        LagWindow raw;
+        MeasureCorr measure;
+        BudgetReservation windows(budget, 4 * static_cast<size_t>(win_hi - win_lo + 1) * sizeof(double));
+        bool failed;
+        if (job.has_prior)
+        {
+          // only around the prior (tdoa2_measure_prior), the searched lags take the place of the valid area
+          auto correlate = [&](long lag_lo, long lag_hi, std::vector<double> &corr, double &peak)
+          {
+            return block_xcorr(*a, *b, n, lag_lo, lag_hi, plan.measure_fft_len, budget, corr, peak);
+          };
+          LagPrior lag_prior = tdoa2_lag_prior(job.prior, ref1[j].idx, n, job.rx_distance_diff, config.layout.sample_rate);
+          ValidWindow searched = valid;
+          failed = tdoa2_measure_prior(correlate, n, valid, lag_prior, half_span, config.report, raw, searched);
+          valid = searched;
+        }
+        else
+        {
+          raw.lag_lo = win_lo - (n - 1);
+          failed = block_xcorr(*a, *b, n, raw.lag_lo, win_hi - (n - 1), plan.measure_fft_len, budget, raw.corr, raw.peak);
+        }
+        if (failed || tdoa2_measure_corr(raw, n, valid, config.smoothing_factor, measure))
+        {
+          pair_ok[j] = false;
+          continue;
+        }
+
+        Tdoa2Result &result = jobs[j].result;
+        double interp2;
+        if (tdoa2_peak_delay(measure.corr, measure.idx, valid.lo, n, config.interpol, result.delay2, interp2))
+        {
+          pair_ok[j] = false;
+          continue;
+        }
+        if (config.interpol > 1)
+          result.delay2 = interp2;
+        result.delay1 = ref1[j].delay;
+        result.delay3 = ref3[j].delay;
+        result.reliability1 = ref1[j].reliability;
+        result.reliability2 = measure.reliability;
+        result.reliability3 = ref3[j].reliability;
+        tdoa2_combine(config, job.rx_distance_diff, result);
+        jobs[j].ok = true;
+      }
+    }
+  }
+  catch (const std::bad_alloc &)
+  {
+    std::cerr << "Error: memory budget of " << budget.limit() / (1024 * 1024) << " MB exceeded!" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,48 @@
+#ifndef BUDGET_PAIRS_H
+#define BUDGET_PAIRS_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include "Tdoa2.h"
+#include "MultiRx.h"
+#include "MemoryBudget.h"
+
+// tdoa2 of receiver pairs within a hard memory budget (small receiver nodes), single threaded:
+// - captures are never held in memory, slices are read from the files in chunks, filtered and
+//   turned into abs/dphase values on the fly (same values as tdoa2_prepare_slice)
+// - correlations only cover a bounded lag range and are computed block by block (overlap-save)
+//   with in-place ffts, the block length is chosen from the budget (lag windows wider than half a
+//   block take several passes over the slices)
+// - the reference correlations search lags +-ref_max_lag (the full engine searches the whole slice),
+//   the measurement correlation the valid window of tdoa2.m as before (or only the lags around the
+//   prior of a job, RxPairJob::prior)
+// - only full correlations (tdoa2_full_ref), no welch averaging, coarse-fine or DAB search, no
+//   resampling of the measurement slices (DRIFT_RESAMPLE) and no matched filter (measure_template)
+// all buffers are charged to the budget (MemoryBudget.h)
+
+enum BudgetStrategy
+{
+  BUDGET_RESIDENT, // the sequences of one slice of all receivers are kept, every slice is prepared once
+  BUDGET_STREAMED  // only chunk and fft buffers, every correlation reads both receivers again
+};
+
+struct BudgetPlan
+{
+  BudgetStrategy strategy;
+  size_t ref_fft_len;     // block fft length of the reference correlations
+  size_t measure_fft_len; // block fft length of the measurement correlations
+  size_t estimate;        // planned peak of the tracked bytes
+};
+
+// the plan with the largest blocks that fits, resident before streamed (num_rx: receivers of the capture)
+// returns 1 if not even the streamed plan with the smallest blocks fits (estimate: the bytes it needs)
+int budget_plan(const Tdoa2Config &config, size_t num_rx, const std::vector<RxPairJob> &jobs, long ref_max_lag,
+                size_t budget_bytes, BudgetPlan &plan);
+
+// files[rx]: capture file of receiver rx (8 bit I/Q as for ReadIQ)
+// returns 1 on read errors or if the budget is exceeded, a pair that cannot be evaluated only clears its ok flag
+int tdoa2_pairs_budgeted(const std::vector<std::string> &files, const Tdoa2Config &config, long ref_max_lag,
+                         const BudgetPlan &plan, std::vector<RxPairJob> &jobs, MemoryBudget &budget);
+
+#endif
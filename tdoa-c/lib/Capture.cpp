@@ -0,0 +1,232 @@
+#include "Capture.h"
+#include "ReadIQ.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+
+int capture_pair_jobs(const TdoaConfig &config, std::vector<RxPairJob> &jobs)
+{
+  std::vector<std::pair<size_t, size_t>> pairs;
+  if (config.rx_pair_list(pairs))
+    return 1;
+
+  LatLong geo_ref = config.geo_ref();
+  jobs.clear();
+  for (const auto &pair : pairs)
+  {
+    RxPairJob job;
+    size_t i = pair.first, j = pair.second;
+    job.rx1 = i;
+    job.rx2 = j;
+    // (Ref to RX i - Ref to RX j) in meters
+    job.rx_distance_diff = dist_latlong(config.tx_ref, config.rx[i], geo_ref) - dist_latlong(config.tx_ref, config.rx[j], geo_ref);
+    job.rx_distance = dist_latlong(config.rx[i], config.rx[j], geo_ref);
+    // a prior of the pair in the other order has the opposite sign
+    auto prior = config.lag_priors.find({i, j});
+    auto reverse = config.lag_priors.find({j, i});
+    job.has_prior = prior != config.lag_priors.end() || reverse != config.lag_priors.end();
+    if (prior != config.lag_priors.end())
+      job.prior = prior->second;
+    else if (reverse != config.lag_priors.end())
+      job.prior = LagPrior{-reverse->second.center, reverse->second.tolerance};
+    job.ok = false;
+    jobs.push_back(job);
+  }
+  return 0;
+}
+
+int capture_tasks(TaskGraph &graph, const TdoaConfig &config, Capture &capture, bool report, TaskGraph::TaskId &last,
+                  ResultCache *cache)
+{
+  if (capture_pair_jobs(config, capture.pairs))
+    return 1;
+  capture.located = false;
+  capture.fix_cached = false;
+  Tdoa2Config tdoa2_config = config.tdoa2_config();
+  tdoa2_config.report = report;
+
+  // cache lookup before any processing, the keys only need the file contents
+  const size_t num_rx = config.rx.size();
+  capture.pair_keys.assign(capture.pairs.size(), 0);
+  capture.pending.clear();
+  capture.pending_pair.clear();
+  if (cache)
+  {
+    std::vector<uint64_t> file_hash(num_rx);
+    std::vector<bool> hashed(num_rx, false);
+    std::vector<std::pair<size_t, size_t>> pair_rx;
+    for (const RxPairJob &job : capture.pairs)
+    {
+      for (size_t rx : {job.rx1, job.rx2})
+        if (!hashed[rx])
+        {
+          if (hash_file(config.rx_file(rx, capture.id), file_hash[rx]))
+            return 1;
+          hashed[rx] = true;
+        }
+      pair_rx.emplace_back(job.rx1, job.rx2);
+    }
+    for (size_t i = 0; i < capture.pairs.size(); ++i)
+    {
+      RxPairJob &job = capture.pairs[i];
+      capture.pair_keys[i] = cache_pair_key(file_hash[job.rx1], file_hash[job.rx2], tdoa2_config, job.rx_distance_diff,
+                                            job.rx_distance, job.has_prior ? &job.prior : nullptr);
+      if (!cache->load_pair(capture.pair_keys[i], job.ok, job.result))
+      {
+        capture.pending.push_back(job);
+        capture.pending_pair.push_back(i);
+      }
+    }
+    capture.fix_key = cache_fix_key(capture.pair_keys, pair_rx, config.rx, config.heatmap_resolution);
+    if (capture.pending.empty())
+    {
+      Heatmap &heatmap = capture.heatmap;
+      capture.fix_cached = cache->load_fix(capture.fix_key, capture.located, heatmap.peak);
+      if (capture.fix_cached)
+      {
+        heatmap.lat.clear();
+        heatmap.lon.clear();
+        heatmap.mag.clear();
+      }
+    }
+  }
+  else
+  {
+    capture.pending = capture.pairs;
+    for (size_t i = 0; i < capture.pairs.size(); ++i)
+      capture.pending_pair.push_back(i);
+  }
+
+  // buffers of a previous capture keep their capacity, only receivers of pending pairs are read
+  capture.signals.resize(num_rx);
+  for (auto &signal : capture.signals)
+    signal.clear();
+  capture.views.assign(num_rx, {});
+  std::vector<TaskGraph::TaskId> read_tasks(num_rx, SIZE_MAX);
+  for (const RxPairJob &job : capture.pending)
+    for (size_t rx : {job.rx1, job.rx2})
+      if (read_tasks[rx] == SIZE_MAX)
+        read_tasks[rx] = graph.add("rx" + std::to_string(rx + 1) + " read", [&config, &capture, rx, report]()
+        {
+          if (ReadIQ(config.rx_file(rx, capture.id), capture.signals[rx], report))
+            return 1;
+          capture.views[rx] = capture.signals[rx];
+          return 0;
+        }, {}, "read");
+
+  std::vector<TaskGraph::TaskId> pair_tasks =
+      tdoa2_pairs_tasks(graph, capture.views, read_tasks, tdoa2_config, capture.pending, capture.prepared);
+
+  // geolocation of all pairs, one thread (the pool is busy with other tasks)
+  last = graph.add("heatmap", [&config, &capture, cache]()
+  {
+    for (size_t i = 0; i < capture.pending.size(); ++i)
+    {
+      size_t p = capture.pending_pair[i];
+      capture.pairs[p] = capture.pending[i];
+      if (cache)
+        cache->store_pair(capture.pair_keys[p], capture.pairs[p].ok, capture.pairs[p].result);
+    }
+    if (capture.fix_cached)
+      return 0;
+
+    std::vector<PairTdoa> doa;
+    for (const RxPairJob &job : capture.pairs)
+      if (job.ok)
+        doa.push_back({job.rx1, job.rx2, job.result.doa_meters});
+    if (!doa.empty())
+    {
+      if (create_heatmap(config.rx, doa, config.heatmap_resolution, config.geo_ref(), capture.heatmap, 1, false))
+        return 1;
+      capture.located = true;
+    }
+    if (cache)
+      cache->store_fix(capture.fix_key, capture.located, capture.located ? capture.heatmap.peak : LatLong{0.0, 0.0});
+    return 0;
+  }, pair_tasks, "heatmap");
+  return 0;
+}
+
+int capture_run_budgeted(const TdoaConfig &config, Capture &capture, bool report, MemoryBudget &budget, BudgetPlan &plan)
+{
+  if (capture_pair_jobs(config, capture.pairs))
+    return 1;
+  capture.located = false;
+  capture.fix_cached = false;
+  Tdoa2Config tdoa2_config = config.tdoa2_config();
+  tdoa2_config.report = report;
+
+  const size_t num_rx = config.rx.size();
+  if (budget_plan(tdoa2_config, num_rx, capture.pairs, config.ref_max_lag, budget.limit(), plan))
+  {
+    std::cerr << "Error: memory budget of " << budget.limit() / (1024 * 1024) << " MB is too small, "
+              << (plan.estimate + (1024 * 1024 - 1)) / (1024 * 1024) << " MB needed" << std::endl;
+    return 1;
+  }
+  std::vector<std::string> files;
+  for (size_t rx = 0; rx < num_rx; ++rx)
+    files.push_back(config.rx_file(rx, capture.id));
+  if (tdoa2_pairs_budgeted(files, tdoa2_config, config.ref_max_lag, plan, capture.pairs, budget))
+    return 1;
+
+  std::vector<PairTdoa> doa;
+  for (const RxPairJob &job : capture.pairs)
+    if (job.ok)
+      doa.push_back({job.rx1, job.rx2, job.result.doa_meters});
+  if (doa.empty())
+    return 0;
+  try
+  {
+    // lat, lon and mag of the grid
+    size_t res = static_cast<size_t>(config.heatmap_resolution);
+    BudgetReservation grid(budget, (res * res + 2 * res) * sizeof(double));
+    if (create_heatmap(config.rx, doa, config.heatmap_resolution, config.geo_ref(), capture.heatmap, 1, false))
+      return 1;
+    std::vector<double>().swap(capture.heatmap.mag);
+  }
+  catch (const std::bad_alloc &)
+  {
+    std::cerr << "Error: memory budget of " << budget.limit() / (1024 * 1024) << " MB exceeded by the heatmap!" << std::endl;
+    return 1;
+  }
+  capture.located = true;
+  return 0;
+}
+
+void capture_release(Capture &capture)
+{
+  std::vector<std::vector<std::complex<float>>>().swap(capture.signals);
+  std::vector<std::span<const std::complex<float>>>().swap(capture.views);
+  std::vector<RxPrepared>().swap(capture.prepared);
+  std::vector<double>().swap(capture.heatmap.mag);
+}
+
+void capture_write_header(std::ostream &out, const std::vector<RxPairJob> &pairs)
+{
+  out << "capture_id,status,lat,long";
+  for (const RxPairJob &job : pairs)
+    out << ",doa_" << job.rx1 + 1 << "_" << job.rx2 + 1 << "_m,reliability_" << job.rx1 + 1 << "_" << job.rx2 + 1;
+  out << std::endl;
+}
+
+void capture_write_record(std::ostream &out, const Capture &capture, bool ok)
+{
+  std::ios_base::fmtflags flags = out.flags();
+  std::streamsize precision = out.precision();
+  out << capture.id << "," << (!ok ? "failed" : capture.located ? "ok" : "no_fix") << std::setprecision(9);
+  if (ok && capture.located)
+    out << "," << capture.heatmap.peak.lat << "," << capture.heatmap.peak.lon;
+  else
+    out << ",,";
+  out << std::setprecision(6);
+  for (const RxPairJob &job : capture.pairs)
+  {
+    if (ok && job.ok)
+      out << "," << job.result.doa_meters << "," << job.result.reliability;
+    else
+      out << ",,";
+  }
+  out << std::endl;
+  out.flags(flags);
+  out.precision(precision);
+}
@@ -0,0 +1,62 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <vector>
+#include <string>
+#include <complex>
+#include <span>
+#include <ostream>
+#include "Config.h"
+#include "MultiRx.h"
+#include "Heatmap.h"
+#include "TaskGraph.h"
+#include "ResultCache.h"
+#include "BudgetPairs.h"
+
+// one capture of all receivers (evaluation_main.m) and the state of its tasks
+struct Capture
+{
+  std::string id; // file_identifier of the capture
+  std::vector<std::vector<std::complex<float>>> signals;
+  std::vector<std::span<const std::complex<float>>> views;
+  std::vector<RxPrepared> prepared;
+  std::vector<RxPairJob> pairs;
+  Heatmap heatmap;
+  bool located = false; // heatmap computed from at least one pair
+
+  // result cache state of the last capture_tasks
+  std::vector<uint64_t> pair_keys;  // cache key per pair (with a cache)
+  std::vector<RxPairJob> pending;   // pairs that are computed, copied into pairs by the heatmap task
+  std::vector<size_t> pending_pair; // index of pending[i] in pairs
+  uint64_t fix_key = 0;
+  bool fix_cached = false;          // fix taken from the cache, heatmap holds only the peak
+};
+
+// jobs of the pairs in config.rx_pairs with their reference and RX distances
+int capture_pair_jobs(const TdoaConfig &config, std::vector<RxPairJob> &jobs);
+
+// tasks of one capture: read per receiver -> slices and reference spectrum -> pairs -> heatmap
+// (stages: read, slice, ref fft, pair, heatmap), the files are config.rx_file() with capture.id as
+// file_identifier, report: progress lines of read and filters, the results are left to the caller
+// capture and config must outlive the graph run, returns the heatmap task (1 if the pair list is invalid)
+// with a cache the receiver files are hashed first, pairs found in the cache get no tasks (nor do the
+// receivers only they use) and the heatmap task stores the new pairs and the fix; if every pair and the
+// fix are cached the graph holds only the heatmap task (returns 1 if a file cannot be hashed)
+int capture_tasks(TaskGraph &graph, const TdoaConfig &config, Capture &capture, bool report, TaskGraph::TaskId &last,
+                  ResultCache *cache = nullptr);
+
+// the same capture with the budgeted engine (BudgetPairs.h), on the calling thread: pairs, then heatmap
+// (charged to the budget as well), plan: the chosen strategy, no cache, no sample buffers in capture
+// returns 1 if the budget is too small (plan.estimate: the bytes needed), on read errors or if it is exceeded
+int capture_run_budgeted(const TdoaConfig &config, Capture &capture, bool report, MemoryBudget &budget, BudgetPlan &plan);
+
+// frees the sample and spectrum buffers, results are kept
+// (not needed between captures: capture_tasks reuses the buffers of a previous capture)
+void capture_release(Capture &capture);
+
+// csv result record: capture_id,status,lat,long,doa_<i>_<j>_m,reliability_<i>_<j>,...
+// status: ok, no_fix (no pair correlated) or failed (ok = false)
+void capture_write_header(std::ostream &out, const std::vector<RxPairJob> &pairs);
+void capture_write_record(std::ostream &out, const Capture &capture, bool ok);
+
+#endif
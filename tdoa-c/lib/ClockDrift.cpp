@@ -0,0 +1,45 @@
+#include "ClockDrift.h"
+#include <iostream>
+#include <cmath>
+
+double drift_delay_at(const DriftModel &model, double t)
+{
+  return model.offset + model.slope * (t - model.t_ref);
+}
+
+void drift_model(double delay1, double reliability1, double delay3, double reliability3, const SliceLayout &layout,
+                 double max_drift_ppm, DriftModel &model)
+{
+  double t1 = layout.slice_centre(0);
+  double t3 = layout.slice_centre(2);
+
+  model.t_ref = t1;
+  model.slope = (delay3 - delay1) / (t3 - t1);
+  model.drift_ppm = model.slope * 1e6;
+  model.offset = delay1;
+  model.linear = std::fabs(model.drift_ppm) <= max_drift_ppm;
+  if (!model.linear)
+  {
+    model.offset = reliability1 > reliability3 ? delay1 : delay3;
+    model.slope = 0.0;
+  }
+}
+
+double ref_delay_at_measurement(double delay1, double reliability1, double delay3, double reliability3,
+                                const SliceLayout &layout, double max_drift_ppm, DriftModel &model)
+{
+  drift_model(delay1, reliability1, delay3, reliability3, layout, max_drift_ppm, model);
+  if (!model.linear)
+  {
+    std::cout << "WARNING: BAD REFERENCE SIGNALS: ref delays imply a drift of " << model.drift_ppm
+              << " ppm (limit " << max_drift_ppm << " ppm)!" << std::endl;
+    if (reliability1 > reliability3)
+      std::cout << "taking ref with higher reliability, i.e. ref (reliability: " << reliability1 << "(ref) > "
+                << reliability3 << "(ref check)" << std::endl;
+    else
+      std::cout << "taking ref with higher reliability, i.e. ref check (reliability: " << reliability1 << "(ref) < "
+                << reliability3 << "(ref check)" << std::endl;
+  }
+
+  return drift_delay_at(model, layout.slice_centre(1));
+}
@@ -0,0 +1,34 @@
+#ifndef CLOCK_DRIFT_H
+#define CLOCK_DRIFT_H
+
+#include "SliceLayout.h"
+
+// linear model of the relative delay between two receivers over the capture
+// delay(t) = offset + slope * (t - t_ref), t in samples
+struct DriftModel
+{
+  double t_ref;     // time of 'offset' (centre of the first reference slice)
+  double offset;    // delay at t_ref in samples
+  double slope;     // delay change per sample = relative sample rate offset
+  double drift_ppm; // slope * 1e6
+  bool linear;      // false: both references disagree beyond max_drift_ppm, constant model
+};
+
+// the model through the delays of reference slice 0 and 2 (slice centres), without console output
+// beyond max_drift_ppm: constant model at the delay of the more reliable reference (linear = false)
+void drift_model(double delay1, double reliability1, double delay3, double reliability3, const SliceLayout &layout,
+                 double max_drift_ppm, DriftModel &model);
+
+// reference delay of the measurement slice from the delays of reference slice 0 and 2
+// delay1/delay3: (fractional) delays of the reference slices, reliability1/3 their reliability
+// tdoa2.m averages both delays, which ignores the clock drift between the receivers; here the
+// line through both slice centres is evaluated at the centre of the measurement slice
+// if the implied drift exceeds max_drift_ppm, the more reliable reference is used (as in tdoa2.m)
+// returns the reference delay for the measurement slice
+double ref_delay_at_measurement(double delay1, double reliability1, double delay3, double reliability3,
+                                const SliceLayout &layout, double max_drift_ppm, DriftModel &model);
+
+// delay predicted by the model at sample t
+double drift_delay_at(const DriftModel &model, double t);
+
+#endif
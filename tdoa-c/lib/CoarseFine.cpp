@@ -0,0 +1,90 @@
+#include "CoarseFine.h"
+#include "CorrReliability.h"
+#include <iostream>
+#include <algorithm>
+
+namespace
+{
+  // block sums of the mean free sequence (a simple anti alias filter plus decimation)
+  void decimate(const PreparedIQ &in, size_t decimation, PreparedIQ &out)
+  {
+    size_t n = in.seq.size() / decimation;
+    out.seq.assign(n, 0.0);
+    double sum_sq = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      const double *x = in.seq.data() + i * decimation;
+      double s = 0.0;
+      for (size_t k = 0; k < decimation; ++k)
+        s += x[k];
+      s -= static_cast<double>(decimation) * in.mean;
+      out.seq[i] = s;
+      sum_sq += s * s;
+    }
+    out.mean = 0.0;
+    out.energy = sum_sq;
+  }
+
+  // full correlation of the decimated signals, n_coarse: their length
+  int xcorr_coarse(const PreparedIQ &a, const PreparedIQ &b, size_t decimation, std::vector<double> &corr_coarse,
+                   long &n_coarse)
+  {
+    PreparedIQ a_coarse, b_coarse;
+    decimate(a, decimation, a_coarse);
+    decimate(b, decimation, b_coarse);
+    n_coarse = static_cast<long>(std::max(a_coarse.seq.size(), b_coarse.seq.size()));
+    double peak_coarse;
+    return xcorr_fft(a_coarse, b_coarse, corr_coarse, peak_coarse);
+  }
+}
+
+int xcorr_coarse_reliability(const PreparedIQ &a, const PreparedIQ &b, size_t decimation, double &reliability)
+{
+  reliability = 0.0;
+  size_t n = std::max(a.seq.size(), b.seq.size());
+  decimation = std::max<size_t>(decimation, 1);
+  if (n / decimation < 2)
+    return 0;
+  std::vector<double> corr_coarse;
+  long n_coarse;
+  if (xcorr_coarse(a, b, decimation, corr_coarse, n_coarse))
+    return 1;
+  reliability = corr_reliability(corr_coarse);
+  return 0;
+}
+
+int xcorr_coarse_fine(const PreparedIQ &a, const PreparedIQ &b, const CoarseFineConfig &config,
+                      LagWindow &window, double &coarse_reliability, bool &fallback, bool report)
+{
+  long n = static_cast<long>(std::max(a.seq.size(), b.seq.size()));
+  long d = static_cast<long>(std::max<size_t>(config.decimation, 1));
+  fallback = false;
+  coarse_reliability = 0.0;
+
+  if (n / d >= 2)
+  {
+    std::vector<double> corr_coarse;
+    long n_coarse;
+    if (xcorr_coarse(a, b, static_cast<size_t>(d), corr_coarse, n_coarse))
+      return 1;
+    coarse_reliability = corr_reliability(corr_coarse);
+
+    if (coarse_reliability >= config.min_reliability)
+    {
+      long idx = std::max_element(corr_coarse.begin(), corr_coarse.end()) - corr_coarse.begin();
+      long lag_coarse = idx - (n_coarse - 1);
+
+      // a coarse sample spans d full rate lags, search one extra coarse sample on each side
+      long half = (config.refine_coarse_samples + 1) * d + config.margin;
+      window.lag_lo = std::max(-(n - 1), lag_coarse * d - half);
+      long lag_hi = std::min(n - 1, lag_coarse * d + half);
+      return xcorr_window(a, b, window.lag_lo, lag_hi, window.corr, window.peak);
+    }
+    if (report)
+      std::cout << "coarse correlation unreliable (" << coarse_reliability << "), full search" << std::endl;
+  }
+
+  fallback = true;
+  window.lag_lo = -(n - 1);
+  return xcorr_fft(a, b, window.corr, window.peak);
+}
@@ -0,0 +1,37 @@
+#ifndef COARSE_FINE_H
+#define COARSE_FINE_H
+
+#include <vector>
+#include <cstddef>
+#include "CorrelateIQ.h"
+
+struct CoarseFineConfig
+{
+  size_t decimation = 16;        // block sums of this many samples form the coarse signal
+  long refine_coarse_samples = 1; // full rate search +- this many coarse samples around the coarse peak
+  long margin = 0;               // extra lags on both sides (e.g. half smoothing span)
+  double min_reliability = 0.2;  // coarse corr_reliability below this -> full search
+};
+
+// result of a correlation that only covers part of the lags
+struct LagWindow
+{
+  long lag_lo;              // lag of corr[0]
+  std::vector<double> corr; // raw correlation for lags lag_lo .. lag_lo + corr.size() - 1
+  double peak;              // maximum of corr
+};
+
+// coarse-to-fine delay search: full correlation of the decimated signals, then full rate
+// correlation only in a small lag window around the coarse peak (xcorr_window)
+// falls back to the full correlation when the coarse reliability is below min_reliability
+// coarse_reliability: reliability of the coarse correlation, fallback: full search was used
+// report = false skips the console note of the fallback
+int xcorr_coarse_fine(const PreparedIQ &a, const PreparedIQ &b, const CoarseFineConfig &config,
+                      LagWindow &window, double &coarse_reliability, bool &fallback, bool report = true);
+
+// corr_reliability of the full correlation of the decimated signals (the first step of
+// xcorr_coarse_fine), a reliability over all lags for searches that correlate a lag window only
+// 0 if the signals are shorter than two decimated samples
+int xcorr_coarse_reliability(const PreparedIQ &a, const PreparedIQ &b, size_t decimation, double &reliability);
+
+#endif
@@ -0,0 +1,393 @@
+#include "Config.h"
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <cstdlib>
+#include <cerrno>
+#include <algorithm>
+#include <charconv>
+
+namespace
+{
+  std::string trim(const std::string &s)
+  {
+    size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos)
+      return "";
+    size_t e = s.find_last_not_of(" \t\r");
+    return s.substr(b, e - b + 1);
+  }
+
+  // value without comment, trailing ';' and quotes
+  bool parse_value(const std::string &raw, std::string &value)
+  {
+    std::string s = trim(raw);
+    if (!s.empty() && (s[0] == '\'' || s[0] == '"'))
+    {
+      size_t end = s.find(s[0], 1);
+      if (end == std::string::npos)
+        return false;
+      value = s.substr(1, end - 1);
+      return true;
+    }
+    size_t comment = s.find_first_of("%#;");
+    value = trim(s.substr(0, comment));
+    return !value.empty();
+  }
+
+  bool to_double(const std::string &s, double &v)
+  {
+    char *end;
+    errno = 0;
+    v = std::strtod(s.c_str(), &end);
+    return errno == 0 && end != s.c_str() && *end == '\0';
+  }
+
+  bool to_int(const std::string &s, int &v)
+  {
+    double d;
+    if (!to_double(s, d) || d != static_cast<double>(static_cast<int>(d)))
+      return false;
+    v = static_cast<int>(d);
+    return true;
+  }
+
+  bool valid_bandwidth(int khz)
+  {
+    return khz == 400 || khz == 200 || khz == 40 || khz == 12 || khz == 0;
+  }
+
+  // rx<k>_lat / rx<k>_long, k >= 1
+  bool rx_key(const std::string &key, size_t &rx, bool &is_lat)
+  {
+    if (key.size() < 4 || key.compare(0, 2, "rx") != 0)
+      return false;
+    size_t us = key.find('_');
+    if (us == std::string::npos || us == 2)
+      return false;
+    std::string num = key.substr(2, us - 2), field = key.substr(us + 1);
+    if (num.find_first_not_of("0123456789") != std::string::npos || (field != "lat" && field != "long"))
+      return false;
+    rx = static_cast<size_t>(std::atoi(num.c_str()));
+    is_lat = field == "lat";
+    return rx >= 1;
+  }
+
+  // lag_prior_<i>_<j>, i, j >= 1
+  bool lag_prior_key(const std::string &key, size_t &rx1, size_t &rx2)
+  {
+    auto number = [](const std::string &s, size_t &rx)
+    {
+      auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), rx);
+      return ec == std::errc() && end == s.data() + s.size() && rx >= 1;
+    };
+    std::string pair = key.substr(std::string("lag_prior_").size());
+    size_t us = pair.find('_');
+    return us != std::string::npos && number(pair.substr(0, us), rx1) && number(pair.substr(us + 1), rx2);
+  }
+
+  // '<center>, <tolerance>'
+  bool to_lag_prior(const std::string &s, LagPrior &prior)
+  {
+    size_t comma = s.find(',');
+    return comma != std::string::npos && to_double(trim(s.substr(0, comma)), prior.center) &&
+           to_double(trim(s.substr(comma + 1)), prior.tolerance) && prior.tolerance >= 0.0;
+  }
+}
+
+std::string TdoaConfig::rx_file(size_t rx) const
+{
+  return rx_file(rx, file_identifier);
+}
+
+std::string TdoaConfig::rx_file(size_t rx, const std::string &file_identifier) const
+{
+  return folder_identifier + std::to_string(rx + 1) + "_" + file_identifier;
+}
+
+bool parse_rx_file_name(const std::string &name, size_t &rx, std::string &file_identifier)
+{
+  size_t us = name.find('_');
+  if (us == 0 || us == std::string::npos)
+    return false;
+  auto [end, ec] = std::from_chars(name.data(), name.data() + us, rx);
+  if (ec != std::errc() || end != name.data() + us)
+    return false;
+  file_identifier = name.substr(us + 1);
+  return true;
+}
+
+LatLong TdoaConfig::geo_ref() const
+{
+  LatLong ref = {0.0, 0.0};
+  for (const LatLong &p : rx)
+  {
+    ref.lat += p.lat / static_cast<double>(rx.size());
+    ref.lon += p.lon / static_cast<double>(rx.size());
+  }
+  return ref;
+}
+
+Tdoa2Config TdoaConfig::tdoa2_config() const
+{
+  Tdoa2Config c;
+  c.smoothing_factor = smoothing_factor;
+  c.corr_type = corr_type;
+  c.signal_bandwidth_khz = signal_bandwidth_khz;
+  c.ref_bandwidth_khz = ref_bandwidth_khz;
+  c.smoothing_factor_ref = smoothing_factor_ref;
+  c.interpol = interpol_factor;
+  c.corr_segment_len = corr_segment_len;
+  c.corr_mode = corr_mode;
+  c.layout = layout;
+  c.drift_compensation = drift_compensation;
+  c.measure_template = measure_template;
+  c.max_drift_ppm = max_drift_ppm;
+  return c;
+}
+
+int TdoaConfig::rx_pair_list(std::vector<std::pair<size_t, size_t>> &pairs) const
+{
+  pairs.clear();
+  if (rx_pairs == "all" || rx_pairs == "star")
+  {
+    for (size_t i = 0; i < rx.size(); ++i)
+      for (size_t j = i + 1; j < rx.size() && (i == 0 || rx_pairs == "all"); ++j)
+        pairs.emplace_back(i, j);
+    return 0;
+  }
+
+  size_t pos = 0;
+  while (pos <= rx_pairs.size())
+  {
+    size_t end = std::min(rx_pairs.find(',', pos), rx_pairs.size());
+    std::string item = trim(rx_pairs.substr(pos, end - pos));
+    size_t dash = item.find('-');
+    int a, b;
+    if (dash == std::string::npos || !to_int(trim(item.substr(0, dash)), a) || !to_int(trim(item.substr(dash + 1)), b) ||
+        a < 1 || b < 1 || a == b || static_cast<size_t>(std::max(a, b)) > rx.size())
+    {
+      std::cerr << "Error: invalid receiver pair '" << item << "' in rx_pairs" << std::endl;
+      return 1;
+    }
+    pairs.emplace_back(static_cast<size_t>(a - 1), static_cast<size_t>(b - 1));
+    pos = end + 1;
+  }
+  return 0;
+}
+
+int load_config(const std::string &filename, TdoaConfig &config)
+{
+  std::ifstream file(filename);
+  if (!file.is_open())
+  {
+    std::cerr << "Error: config file " << filename << " cannot be opened!" << std::endl;
+    return 1;
+  }
+
+  std::map<size_t, LatLong> rx;
+  std::map<size_t, int> rx_fields; // bit 0: lat, bit 1: long
+  for (size_t i = 0; i < config.rx.size(); ++i)
+  {
+    rx[i + 1] = config.rx[i];
+    rx_fields[i + 1] = 3;
+  }
+
+  std::string line;
+  int line_no = 0;
+  int errors = 0;
+  while (std::getline(file, line))
+  {
+    ++line_no;
+    std::string s = trim(line);
+    if (s.empty() || s[0] == '%' || s[0] == '#' || s[0] == ';' || s[0] == '[')
+      continue;
+
+    size_t eq = s.find('=');
+    std::string value;
+    if (eq == std::string::npos || !parse_value(s.substr(eq + 1), value))
+    {
+      std::cerr << "Error: " << filename << ":" << line_no << ": expected 'name = value'" << std::endl;
+      ++errors;
+      continue;
+    }
+    std::string key = trim(s.substr(0, eq));
+
+    bool ok = true;
+    double d;
+    int i;
+    size_t rx_idx;
+    bool is_lat;
+    if (rx_key(key, rx_idx, is_lat))
+    {
+      ok = to_double(value, d);
+      (is_lat ? rx[rx_idx].lat : rx[rx_idx].lon) = d;
+      rx_fields[rx_idx] |= is_lat ? 1 : 2;
+    }
+    else if (key.compare(0, 10, "lag_prior_") == 0)
+    {
+      size_t rx1, rx2;
+      LagPrior prior;
+      ok = lag_prior_key(key, rx1, rx2) && rx1 != rx2 && to_lag_prior(value, prior);
+      if (ok)
+        config.lag_priors[{rx1 - 1, rx2 - 1}] = prior;
+    }
+    else if (key == "tx_ref_lat")
+      ok = to_double(value, config.tx_ref.lat);
+    else if (key == "tx_ref_long")
+      ok = to_double(value, config.tx_ref.lon);
+    else if (key == "rx_pairs")
+      config.rx_pairs = value;
+    else if (key == "file_identifier")
+      config.file_identifier = value;
+    else if (key == "folder_identifier")
+      config.folder_identifier = value;
+    else if (key == "cache_dir")
+      config.cache_dir = value;
+    else if (key == "signal_bandwidth_khz")
+      ok = to_int(value, config.signal_bandwidth_khz) && valid_bandwidth(config.signal_bandwidth_khz);
+    else if (key == "ref_bandwidth_khz")
+      ok = to_int(value, config.ref_bandwidth_khz) && valid_bandwidth(config.ref_bandwidth_khz);
+    else if (key == "smoothing_factor")
+      ok = to_int(value, config.smoothing_factor) && config.smoothing_factor >= 0;
+    else if (key == "smoothing_factor_ref")
+      ok = to_int(value, config.smoothing_factor_ref) && config.smoothing_factor_ref >= 0;
+    else if (key == "corr_type")
+    {
+      ok = value == "abs" || value == "dphase";
+      config.corr_type = value == "abs" ? CORR_ABS : CORR_DPHASE;
+    }
+    else if (key == "interpol_factor")
+      ok = to_int(value, config.interpol_factor) && config.interpol_factor >= 0;
+    else if (key == "report_level")
+      ok = to_int(value, config.report_level);
+    else if (key == "trace_file")
+      config.trace_file = value;
+    else if (key == "template_file")
+      config.template_file = value;
+    else if (key == "map_mode")
+    {
+      ok = value == "open_street_map" || value == "google_maps";
+      config.map_mode = value;
+    }
+    else if (key == "heatmap_resolution")
+      ok = to_int(value, config.heatmap_resolution) && config.heatmap_resolution > 0;
+    else if (key == "heatmap_threshold")
+      ok = to_double(value, config.heatmap_threshold);
+    else if (key == "corr_segment_len")
+    {
+      ok = to_int(value, i) && i >= 0;
+      config.corr_segment_len = static_cast<size_t>(i);
+    }
+    else if (key == "corr_mode")
+    {
+      ok = value == "full" || value == "coarse_fine" || value == "dab";
+      config.corr_mode = value == "coarse_fine" ? CORR_MODE_COARSE_FINE : value == "dab" ? CORR_MODE_DAB : CORR_MODE_FULL;
+    }
+    else if (key == "drift_compensation")
+    {
+      ok = value == "resample" || to_int(value, i);
+      config.drift_compensation = value == "resample" ? DRIFT_RESAMPLE : ok && i != 0 ? DRIFT_REF_DELAY : DRIFT_OFF;
+    }
+    else if (key == "max_drift_ppm")
+      ok = to_double(value, config.max_drift_ppm) && config.max_drift_ppm >= 0.0;
+    else if (key == "memory_budget_mb")
+    {
+      ok = to_int(value, i) && i >= 0;
+      config.memory_budget_mb = static_cast<size_t>(i);
+    }
+    else if (key == "ref_max_lag")
+    {
+      ok = to_int(value, i) && i >= 0;
+      config.ref_max_lag = i;
+    }
+    else if (key == "num_samples_per_freq" || key == "num_samples_per_slice" || key == "guard_interval")
+    {
+      ok = to_int(value, i) && i > 0;
+      size_t &field = key == "num_samples_per_freq"    ? config.layout.samples_per_freq
+                      : key == "num_samples_per_slice" ? config.layout.samples_per_slice
+                                                       : config.layout.guard_interval;
+      if (ok)
+        field = static_cast<size_t>(i);
+    }
+    else if (key == "sample_rate")
+      ok = to_double(value, config.layout.sample_rate) && config.layout.sample_rate > 0.0;
+    else
+      std::cout << "config: ignoring unknown parameter " << key << " (" << filename << ":" << line_no << ")" << std::endl;
+
+    if (!ok)
+    {
+      std::cerr << "Error: " << filename << ":" << line_no << ": invalid value '" << value << "' for " << key << std::endl;
+      ++errors;
+    }
+  }
+
+  // receivers must be numbered 1..N with both coordinates
+  config.rx.clear();
+  for (const auto &entry : rx)
+  {
+    if (entry.first != config.rx.size() + 1 || rx_fields[entry.first] != 3)
+    {
+      std::cerr << "Error: " << filename << ": rx" << entry.first << " position incomplete or rx numbers not consecutive" << std::endl;
+      return 1;
+    }
+    config.rx.push_back(entry.second);
+  }
+
+  // the welch average is a correlation of its own, the coarse-fine and DAB searches only narrow a full one
+  if (config.corr_segment_len > 0 && config.corr_mode != CORR_MODE_FULL)
+  {
+    std::cerr << "Error: " << filename << ": corr_segment_len needs corr_mode = full" << std::endl;
+    return 1;
+  }
+  // the budgeted engine only has full (lag bounded) correlations
+  if (config.memory_budget_mb > 0 && !tdoa2_full_ref(config.tdoa2_config()))
+  {
+    std::cerr << "Error: " << filename << ": corr_segment_len and corr_mode need the full engine (memory_budget_mb = 0)"
+              << std::endl;
+    return 1;
+  }
+
+  // the budgeted engine streams the measurement slices, it has no copy to resample
+  if (config.memory_budget_mb > 0 && config.drift_compensation == DRIFT_RESAMPLE)
+  {
+    std::cerr << "Error: " << filename << ": drift_compensation = resample needs the full engine (memory_budget_mb = 0)"
+              << std::endl;
+    return 1;
+  }
+
+  // the matched filter replaces the measurement correlation, the budgeted engine has only the latter
+  if (!config.template_file.empty())
+  {
+    if (config.memory_budget_mb > 0 || config.drift_compensation == DRIFT_RESAMPLE)
+    {
+      std::cerr << "Error: " << filename << ": template_file needs the full engine (memory_budget_mb = 0) and no "
+                << "drift_compensation = resample" << std::endl;
+      return 1;
+    }
+    config.measure_template = template_cache(config.template_file);
+    if (!config.measure_template)
+      return 1;
+  }
+  else
+    config.measure_template = nullptr;
+
+  // priors are searched with full rate windows
+  if (!config.lag_priors.empty() && config.corr_segment_len > 0)
+  {
+    std::cerr << "Error: " << filename << ": lag priors need corr_segment_len = 0" << std::endl;
+    return 1;
+  }
+  for (const auto &entry : config.lag_priors)
+    if (entry.first.first >= config.rx.size() || entry.first.second >= config.rx.size())
+    {
+      std::cerr << "Error: " << filename << ": lag prior of unknown receivers " << entry.first.first + 1 << " & "
+                << entry.first.second + 1 << std::endl;
+      return 1;
+    }
+
+  std::vector<std::pair<size_t, size_t>> pairs;
+  if (config.rx_pair_list(pairs))
+    return 1;
+  return errors ? 1 : 0;
+}
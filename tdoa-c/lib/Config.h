@@ -0,0 +1,97 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include "Geo.h"
+#include "Tdoa2.h"
+
+// runtime version of config.m
+// the file holds one 'name = value' per line, '%', '#' and ';' start comments, strings may be quoted
+// and a trailing ';' is ignored, so a plain config.m is accepted as well as an ini file
+// ([section] lines are ignored, the names are unique anyway)
+struct TdoaConfig
+{
+  // RX and Ref TX position, rx1_lat/rx1_long, rx2_lat/... in file order
+  std::vector<LatLong> rx;
+  LatLong tx_ref = {0.0, 0.0};
+
+  // receiver pairs: 'all' (N(N-1)/2 pairs), 'star' (rx1 with every other rx, N-1 pairs)
+  // or a list of 1 based pairs like '1-2,2-3,3-4'
+  std::string rx_pairs = "all";
+
+  // IQ data files: <folder_identifier><rx number>_<file_identifier>
+  std::string file_identifier = "test.dat";
+  std::string folder_identifier = "recorded_data/";
+
+  // expected TDOA of receiver pairs (0 based rx1, rx2), e.g. the fix of a fixed emitter:
+  // lag_prior_<i>_<j> = <doa_samples>, <tolerance>, the measurement is only correlated around it
+  std::map<std::pair<size_t, size_t>, LagPrior> lag_priors;
+
+  // result cache directory (empty: no cache), see ResultCache.h
+  std::string cache_dir;
+
+  // signal processing parameters
+  int signal_bandwidth_khz = 0; // 400, 200, 40, 12, 0(no)
+  int smoothing_factor = 0;
+  CorrType corr_type = CORR_DPHASE;
+  int interpol_factor = 0;
+
+  // additional processing of ref signal
+  // (set to > 0 only when other signals than the ref signal falls into the full RX bandwidth)
+  int ref_bandwidth_khz = 0; // 400, 200, 40, 12, 0(no)
+  int smoothing_factor_ref = 0;
+
+  // 0: no plots, > 0: reports
+  int report_level = 0;
+  // chrome trace json of the processing stages (empty: no tracing)
+  std::string trace_file;
+
+  // map output: 'open_street_map' (default) or 'google_maps'
+  std::string map_mode = "open_street_map";
+
+  // heatmap
+  int heatmap_resolution = 400;   // resolution for heatmap points
+  double heatmap_threshold = 0.1; // heatmap point with lower mag are suppressed for html output
+
+  // engine settings without a config.m counterpart
+  size_t corr_segment_len = 0; // 0: one full-length correlation, > 0: welch segment length
+  CorrMode corr_mode = CORR_MODE_FULL; // search of the reference correlations
+  DriftCompensation drift_compensation = DRIFT_OFF;
+  double max_drift_ppm = 2.0 / 2.6;
+  SliceLayout layout;
+
+  // known transmit waveform of the target (iq file like the captures, empty: cross-correlation of the
+  // measurement slices), loaded once per process by load_config (template_cache)
+  std::string template_file;
+  TemplateCache *measure_template = nullptr;
+
+  // memory budgeted engine (BudgetPairs.h), 0: off (full engine, task graph and result cache)
+  size_t memory_budget_mb = 0;
+  long ref_max_lag = 50000; // reference correlation lags of the budgeted engine (samples)
+
+  // file of receiver rx (0 based)
+  std::string rx_file(size_t rx) const;
+  // file of receiver rx for another capture
+  std::string rx_file(size_t rx, const std::string &file_identifier) const;
+
+  // mean of the RX positions (geodetic reference point)
+  LatLong geo_ref() const;
+
+  Tdoa2Config tdoa2_config() const;
+
+  // rx_pairs as 0 based (rx1, rx2), returns 1 for a malformed list or unknown receivers
+  int rx_pair_list(std::vector<std::pair<size_t, size_t>> &pairs) const;
+};
+
+// inverse of rx_file for a file name without folder: <rx number>_<file_identifier>
+// rx is 1 based as in the name, returns false for other names (no digits, out of range, no '_')
+bool parse_rx_file_name(const std::string &name, size_t &rx, std::string &file_identifier);
+
+// reads a config file over the defaults in config, returns 1 on read or value errors
+// unknown names are reported and ignored
+int load_config(const std::string &filename, TdoaConfig &config);
+
+#endif
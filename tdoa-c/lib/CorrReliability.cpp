@@ -0,0 +1,186 @@
+#include "CorrReliability.h"
+#include "PeakHeap.h"
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+  const size_t HEAP_SIZE = 16; // local maxima kept during the scan
+
+  // candidate = local maximum including plateaus and the two ends of the array,
+  // the maximum of every interval outside the main peak flanks is such a candidate
+  inline bool is_candidate(const double *y, size_t n, size_t i)
+  {
+    return (i == 0 || y[i] >= y[i - 1]) && (i + 1 == n || y[i] >= y[i + 1]);
+  }
+
+  struct Scan
+  {
+    size_t idx = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    PeakHeap<HEAP_SIZE> candidates;
+  };
+
+  void scan(const double *y, size_t n, Scan &s)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      double v = y[i];
+      s.sum += v;
+      s.sum_sq += v * v;
+      if (v > y[s.idx])
+        s.idx = i;
+      if ((!s.candidates.full() || v > s.candidates.threshold()) && is_candidate(y, n, i))
+        s.candidates.push(v, i);
+    }
+  }
+
+  // end of the monotonically decreasing flanks: [left, right) contains the main peak
+  void flanks(const double *y, size_t n, size_t idx, size_t &left, size_t &right)
+  {
+    right = idx + 1;
+    double bin_old = y[idx];
+    while (right < n && y[right] < bin_old)
+      bin_old = y[right++];
+
+    left = idx;
+    bin_old = y[idx];
+    while (left > 0 && y[left - 1] < bin_old)
+      bin_old = y[--left];
+  }
+
+  // corr_reliability.m, the deleted values count as 0
+  double reliability(const double *y, size_t n, const Scan &s)
+  {
+    size_t left, right;
+    flanks(y, n, s.idx, left, right);
+
+    // the flanks are strictly decreasing, so apart from the peak no candidate lies inside them
+    // and the largest other candidate is the 2nd peak
+    double peak2 = 0.0;
+    bool found = false;
+    for (size_t k = 0; k < s.candidates.size(); ++k)
+    {
+      size_t i = s.candidates[k].index;
+      if (i < left || i >= right)
+      {
+        peak2 = std::max(peak2, s.candidates[k].value);
+        found = true;
+      }
+    }
+    if (!found && s.candidates.full())
+    {
+      // all kept candidates are ties of the peak inside the flanks, scan the rest
+      for (size_t i = 0; i < left; ++i)
+        peak2 = std::max(peak2, y[i]);
+      for (size_t i = right; i < n; ++i)
+        peak2 = std::max(peak2, y[i]);
+    }
+    return 1.0 - (peak2 / y[s.idx]);
+  }
+}
+
+double corr_reliability(const double *corr, size_t n)
+{
+  if (n == 0)
+    return 0.0;
+
+  Scan s;
+  scan(corr, n, s);
+  return reliability(corr, n, s);
+}
+
+double corr_reliability(const std::vector<double> &corr)
+{
+  return corr_reliability(corr.data(), corr.size());
+}
+
+int corr_reliability_metrics(const double *corr, size_t n, size_t guard, ReliabilityMetrics &metrics)
+{
+  if (n == 0)
+  {
+    std::cerr << "Error: empty correlation for reliability!" << std::endl;
+    return 1;
+  }
+
+  Scan s;
+  scan(corr, n, s);
+  size_t idx = s.idx;
+  double peak = corr[idx];
+
+  metrics.peak_idx = idx;
+  metrics.peak = peak;
+  metrics.reliability = reliability(corr, n, s);
+
+  // sidelobe statistics: the guard zone is removed from the running sums (bounded re-scan)
+  size_t g_lo = (idx > guard) ? idx - guard : 0;
+  size_t g_hi = std::min(n, idx + guard + 1);
+  double sum = s.sum, sum_sq = s.sum_sq;
+  for (size_t i = g_lo; i < g_hi; ++i)
+  {
+    sum -= corr[i];
+    sum_sq -= corr[i] * corr[i];
+  }
+  double count = static_cast<double>(n - (g_hi - g_lo));
+  if (count > 1.0)
+  {
+    double mean = sum / count;
+    double var = std::max(0.0, sum_sq / count - mean * mean);
+    metrics.psr = (var > 0.0) ? (peak - mean) / std::sqrt(var) : std::numeric_limits<double>::infinity();
+  }
+  else
+  {
+    metrics.psr = std::numeric_limits<double>::infinity();
+  }
+
+  // highest local maximum outside the guard zone
+  metrics.second_idx = n;
+  double second = -std::numeric_limits<double>::infinity();
+  for (size_t k = 0; k < s.candidates.size(); ++k)
+  {
+    size_t i = s.candidates[k].index;
+    if ((i < g_lo || i >= g_hi) && s.candidates[k].value > second)
+    {
+      second = s.candidates[k].value;
+      metrics.second_idx = i;
+    }
+  }
+  if (metrics.second_idx == n && s.candidates.full())
+  {
+    // all kept maxima are ripples inside the guard zone, scan outside of it
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (i == g_lo)
+        i = g_hi;
+      if (i < n && is_candidate(corr, n, i) && corr[i] > second)
+      {
+        second = corr[i];
+        metrics.second_idx = i;
+      }
+    }
+  }
+  metrics.peak_to_second = (metrics.second_idx < n && second > 0.0) ? peak / second : std::numeric_limits<double>::infinity();
+
+  // width at half height, linear interpolation of both crossings
+  double half = 0.5 * peak;
+  double w_left = static_cast<double>(idx), w_right = static_cast<double>(idx);
+  size_t i = idx;
+  while (i > 0 && corr[i - 1] > half)
+    --i;
+  w_left = (i > 0) ? static_cast<double>(i) - (corr[i] - half) / (corr[i] - corr[i - 1]) : 0.0;
+  i = idx;
+  while (i + 1 < n && corr[i + 1] > half)
+    ++i;
+  w_right = (i + 1 < n) ? static_cast<double>(i) + (corr[i] - half) / (corr[i] - corr[i + 1]) : static_cast<double>(n - 1);
+  metrics.peak_width = w_right - w_left;
+
+  return 0;
+}
+
+int corr_reliability_metrics(const std::vector<double> &corr, size_t guard, ReliabilityMetrics &metrics)
+{
+  return corr_reliability_metrics(corr.data(), corr.size(), guard, metrics);
+}
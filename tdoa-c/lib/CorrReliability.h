@@ -0,0 +1,29 @@
+#ifndef CORR_RELIABILITY_H
+#define CORR_RELIABILITY_H
+
+#include <vector>
+#include <cstddef>
+
+struct ReliabilityMetrics
+{
+  size_t peak_idx;       // index of the (first) maximum
+  double peak;           // maximum value
+  double reliability;    // corr_reliability.m: 1 - 2nd outstanding peak / main peak
+  double psr;            // peak to sidelobe ratio: (peak - mean) / std of the values outside the guard zone
+  double peak_to_second; // peak / highest local maximum outside the guard zone (inf if there is none)
+  size_t second_idx;     // index of that local maximum (n if there is none)
+  double peak_width;     // width of the main peak at half its height in samples (interpolated)
+};
+
+// corr_reliability.m: 1 - (2nd outstanding peak / main peak), 0 (bad) .. 1 (good)
+// the main peak and its monotonically decreasing flanks are excluded from the 2nd peak search
+double corr_reliability(const double *corr, size_t n);
+double corr_reliability(const std::vector<double> &corr);
+
+// all metrics from one scan over corr (full correlation or a lag window of it) plus bounded walks
+// around the peak, local maxima are kept in a fixed size heap instead of sorting the correlation
+// guard: samples on each side of the peak that belong to the main lobe
+int corr_reliability_metrics(const double *corr, size_t n, size_t guard, ReliabilityMetrics &metrics);
+int corr_reliability_metrics(const std::vector<double> &corr, size_t guard, ReliabilityMetrics &metrics);
+
+#endif
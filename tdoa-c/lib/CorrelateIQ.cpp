@@ -0,0 +1,300 @@
+#include "CorrelateIQ.h"
+#include "FFT.h"
+#include "SmoothCorr.h"
+#include "Trace.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+int prepare_iq(const std::complex<float> *iq, size_t n, CorrType corr_type, PreparedIQ &prepared)
+{
+  TraceSpan span(corr_type == CORR_ABS ? "abs" : "dphase");
+  prepared.seq.resize(n);
+  prepared.mean = 0.0;
+  prepared.energy = 0.0;
+  if (n == 0)
+    return 0;
+
+  double *x = prepared.seq.data();
+  double sum = 0.0, sum_sq = 0.0;
+
+  switch (corr_type)
+  {
+  case CORR_ABS:
+    for (size_t i = 0; i < n; ++i)
+    {
+      double v = std::abs(iq[i]);
+      x[i] = v;
+      sum += v;
+      sum_sq += v * v;
+    }
+    break;
+
+  case CORR_DPHASE:
+  {
+    // diff(unwrap(angle(iq))) with a leading zero: unwrap keeps every jump within [-pi, pi]
+    double phase_old = std::arg(iq[0]);
+    x[0] = 0.0;
+    for (size_t i = 1; i < n; ++i)
+    {
+      double phase = std::arg(iq[i]);
+      double d = phase - phase_old;
+      if (d > M_PI)
+        d -= 2.0 * M_PI;
+      else if (d < -M_PI)
+        d += 2.0 * M_PI;
+      phase_old = phase;
+      x[i] = d;
+      sum += d;
+      sum_sq += d * d;
+    }
+    break;
+  }
+
+  default:
+    std::cerr << "correlate_iq: correlation strategy not supported (choose abs or dphase)" << std::endl;
+    return 1;
+  }
+
+  // remove_mean is deferred to the fft input, the energy follows from the running sums
+  prepared.mean = sum / static_cast<double>(n);
+  prepared.energy = std::max(0.0, sum_sq - static_cast<double>(n) * prepared.mean * prepared.mean);
+  return 0;
+}
+
+int prepare_iq(const std::vector<std::complex<float>> &iq, CorrType corr_type, PreparedIQ &prepared)
+{
+  return prepare_iq(iq.data(), iq.size(), corr_type, prepared);
+}
+
+namespace
+{
+  // cross spectrum of (a - mean_a) and (b - mean_b) in z (len points)
+  // both real sequences are packed into one complex fft: z = a + i*b
+  void cross_spectrum(const PreparedIQ &a, const PreparedIQ &b, size_t len, std::vector<std::complex<double>> &z)
+  {
+    z.assign(len, 0.0);
+    for (size_t i = 0; i < a.seq.size(); ++i)
+      z[i].real(a.seq[i] - a.mean);
+    for (size_t i = 0; i < b.seq.size(); ++i)
+      z[i].imag(b.seq[i] - b.mean);
+    get_fft_plan(len).forward(z);
+
+    // A[k] = (Z[k] + Z*[-k]) / 2, B[k] = (Z[k] - Z*[-k]) / 2i, cross spectrum A[k] * B*[k]
+    // the product is hermitian, so bins k and len-k are done together in place
+    for (size_t k = 0; k <= len / 2; ++k)
+    {
+      size_t kn = (len - k) & (len - 1);
+      std::complex<double> zk = z[k], zn = std::conj(z[kn]);
+      std::complex<double> ak = 0.5 * (zk + zn);
+      std::complex<double> bk = std::complex<double>(0.0, -0.5) * (zk - zn);
+      std::complex<double> c = ak * std::conj(bk);
+      z[k] = c;
+      z[kn] = std::conj(c);
+    }
+  }
+}
+
+int xcorr_fft(const PreparedIQ &a, const PreparedIQ &b, std::vector<double> &corr, double &peak)
+{
+  size_t n = std::max(a.seq.size(), b.seq.size());
+  if (n == 0)
+  {
+    std::cerr << "Error: empty signal for correlation!" << std::endl;
+    return 1;
+  }
+
+  size_t len = next_pow2(2 * n - 1);
+  std::vector<std::complex<double>> z;
+  cross_spectrum(a, b, len, z);
+  get_fft_plan(len).inverse(z);
+
+  // circular lag m at index m mod len, xcorr order is m = -(n-1) .. n-1
+  corr.resize(2 * n - 1);
+  peak = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < 2 * n - 1; ++i)
+  {
+    size_t k = (i + len - (n - 1)) & (len - 1);
+    double v = z[k].real();
+    corr[i] = v;
+    if (v > peak)
+      peak = v;
+  }
+  return 0;
+}
+
+int xcorr_fft_window(const PreparedIQ &a, const PreparedIQ &b, long lag_lo, long lag_hi,
+                     std::vector<double> &corr, double &peak)
+{
+  long n = static_cast<long>(std::max(a.seq.size(), b.seq.size()));
+  if (n == 0 || lag_lo > lag_hi || lag_lo <= -n || lag_hi >= n)
+  {
+    std::cerr << "Error: invalid lag window for correlation!" << std::endl;
+    return 1;
+  }
+
+  size_t len = next_pow2(2 * static_cast<size_t>(n) - 1);
+  std::vector<std::complex<double>> z;
+  cross_spectrum(a, b, len, z);
+
+  size_t count = static_cast<size_t>(lag_hi - lag_lo + 1);
+  std::vector<std::complex<double>> window(count);
+  ifft_window(z.data(), len, lag_lo, count, window.data());
+
+  corr.resize(count);
+  peak = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < count; ++i)
+  {
+    corr[i] = window[i].real();
+    peak = std::max(peak, corr[i]);
+  }
+  return 0;
+}
+
+int xcorr_direct_window(const PreparedIQ &a, const PreparedIQ &b, long lag_lo, long lag_hi,
+                        std::vector<double> &corr, double &peak)
+{
+  long na = static_cast<long>(a.seq.size()), nb = static_cast<long>(b.seq.size());
+  long n = std::max(na, nb);
+  if (n == 0 || lag_lo > lag_hi || lag_lo <= -n || lag_hi >= n)
+  {
+    std::cerr << "Error: invalid lag window for correlation!" << std::endl;
+    return 1;
+  }
+
+  // sum_k (a[k+m] - mean_a) * (b[k] - mean_b) = sum a*b - mean_a*sum b - mean_b*sum a + cnt*mean_a*mean_b
+  // over the overlap, the partial sums of a and b come from prefix sums
+  std::vector<double> prefix_a(na + 1, 0.0), prefix_b(nb + 1, 0.0);
+  for (long k = 0; k < na; ++k)
+    prefix_a[k + 1] = prefix_a[k] + a.seq[k];
+  for (long k = 0; k < nb; ++k)
+    prefix_b[k + 1] = prefix_b[k] + b.seq[k];
+
+  // lags are processed in blocks of LAG_BLOCK, every b[k] is loaded once per block
+  // which divides the memory traffic of the n * count products by LAG_BLOCK
+  const long LAG_BLOCK = 8;
+  corr.resize(static_cast<size_t>(lag_hi - lag_lo + 1));
+  for (long m0 = lag_lo; m0 <= lag_hi; m0 += LAG_BLOCK)
+  {
+    long nl = std::min(LAG_BLOCK, lag_hi - m0 + 1);
+    double s[LAG_BLOCK] = {0.0};
+
+    // overlap common to all lags of the block: k in [k_lo, k_hi) valid for m0 .. m0+nl-1
+    long k_lo = std::max(0L, -m0);
+    long k_hi = std::min(nb, na - (m0 + nl - 1));
+    if (k_hi > k_lo)
+    {
+      // a is indexed at k + m0 >= 0 (k >= k_lo), no pointer before the start of a.seq
+      const double *pa = a.seq.data();
+      const double *pb = b.seq.data();
+      if (nl == LAG_BLOCK)
+      {
+        for (long k = k_lo; k < k_hi; ++k)
+        {
+          const double bk = pb[k];
+          const double *ak = pa + (k + m0);
+          for (long j = 0; j < LAG_BLOCK; ++j)
+            s[j] += ak[j] * bk;
+        }
+      }
+      else
+      {
+        for (long k = k_lo; k < k_hi; ++k)
+          for (long j = 0; j < nl; ++j)
+            s[j] += pa[k + m0 + j] * pb[k];
+      }
+    }
+    else
+    {
+      k_lo = k_hi = std::max(0L, -m0);
+    }
+
+    for (long j = 0; j < nl; ++j)
+    {
+      // products outside the common range of the block
+      long m = m0 + j;
+      long lo = std::max(0L, -m);
+      long hi = std::min(nb, na - m);
+      double dot = s[j];
+      for (long k = lo; k < std::min(k_lo, hi); ++k)
+        dot += a.seq[k + m] * b.seq[k];
+      for (long k = std::max(k_hi, lo); k < hi; ++k)
+        dot += a.seq[k + m] * b.seq[k];
+
+      if (hi > lo)
+      {
+        double sum_a = prefix_a[hi + m] - prefix_a[lo + m];
+        double sum_b = prefix_b[hi] - prefix_b[lo];
+        dot += -a.mean * sum_b - b.mean * sum_a + static_cast<double>(hi - lo) * a.mean * b.mean;
+      }
+      else
+      {
+        dot = 0.0;
+      }
+      corr[m - lag_lo] = dot;
+    }
+  }
+
+  peak = *std::max_element(corr.begin(), corr.end());
+  return 0;
+}
+
+int xcorr_window(const PreparedIQ &a, const PreparedIQ &b, long lag_lo, long lag_hi,
+                 std::vector<double> &corr, double &peak)
+{
+  // direct dot products cost count * n, the fft path about 3 transforms of len points
+  double n = static_cast<double>(std::max(a.seq.size(), b.seq.size()));
+  double len = static_cast<double>(next_pow2(2 * static_cast<size_t>(std::max(n, 1.0)) - 1));
+  double count = static_cast<double>(lag_hi - lag_lo + 1);
+  double fft_cost = 3.0 * len * std::log2(len) * 2.0;
+  if (count * n < fft_cost)
+    return xcorr_direct_window(a, b, lag_lo, lag_hi, corr, peak);
+  return xcorr_fft_window(a, b, lag_lo, lag_hi, corr, peak);
+}
+
+int correlate_iq(const PreparedIQ &a, const PreparedIQ &b, CorrType corr_type, int smoothing_factor,
+                 std::vector<double> &corr, CorrStats &stats, bool report)
+{
+  if (xcorr_fft(a, b, corr, stats.peak))
+    return 1;
+  return correlate_iq_finish(a, b, corr_type, smoothing_factor, corr, stats, report);
+}
+
+int correlate_iq_finish(const PreparedIQ &a, const PreparedIQ &b, CorrType corr_type, int smoothing_factor,
+                        std::vector<double> &corr, CorrStats &stats, bool report)
+{
+  stats.ref1 = a.energy;
+  stats.ref2 = b.energy;
+  stats.peak_percent = (stats.ref1 + stats.ref2 > 0.0) ? 100.0 * 2.0 * stats.peak / (stats.ref1 + stats.ref2) : 0.0;
+
+  if (report)
+  {
+    // formatted apart, the precision of std::cout stays as it is for the later result lines
+    std::ostringstream line;
+    line << std::setprecision(3)
+         << (corr_type == CORR_ABS ? "abs cross-correlation: max (peak) " : "dphase cross-correlation, max (peak) ")
+         << stats.peak << ", autocorr1 max " << stats.ref1 << ", autocorr2 max " << stats.ref2
+         << ", => " << std::setprecision(5) << stats.peak_percent << "%";
+    std::cout << line.str() << std::endl;
+  }
+
+  if (smoothing_factor != 0)
+  {
+    std::vector<double> smoothed;
+    double corr_max;
+    if (smooth_corr(corr, smoothing_factor, smoothed, corr_max))
+      return 1;
+    corr.swap(smoothed);
+  }
+  else if (stats.peak != 0.0)
+  {
+    // peak is already known from the unpacking, normalize without another scan
+    const double scale = 1.0 / stats.peak;
+    for (double &v : corr)
+      v *= scale;
+  }
+  return 0;
+}
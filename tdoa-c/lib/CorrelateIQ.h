@@ -0,0 +1,64 @@
+#ifndef CORRELATE_IQ_H
+#define CORRELATE_IQ_H
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+
+// correlation strategy of correlate_iq.m
+enum CorrType
+{
+  CORR_ABS,   // absolute value of the iq signal
+  CORR_DPHASE // differential phase of the iq signal
+};
+
+// real sequence that correlate_iq.m feeds into xcorr, before remove_mean
+// mean and energy come from running sums of the same pass, so the autocorrelation
+// peak max(xcorr(x, x)) = sum((x - mean).^2) needs no extra correlation
+struct PreparedIQ
+{
+  std::vector<double> seq; // abs or dphase values, mean NOT removed
+  double mean;
+  double energy; // energy of seq - mean, i.e. autocorrelation at lag 0
+};
+
+// results printed by correlate_iq.m
+struct CorrStats
+{
+  double peak; // max of the raw cross-correlation
+  double ref1; // autocorrelation peak of the first signal
+  double ref2; // autocorrelation peak of the second signal
+  double peak_percent; // 100 * 2 * peak / (ref1 + ref2)
+};
+
+int prepare_iq(const std::complex<float> *iq, size_t n, CorrType corr_type, PreparedIQ &prepared);
+int prepare_iq(const std::vector<std::complex<float>> &iq, CorrType corr_type, PreparedIQ &prepared);
+
+// xcorr(a - mean_a, b - mean_b) via one complex FFT pair, length 2N-1 with lag 0 at index N-1
+// peak: maximum of the correlation, tracked while unpacking the ifft output
+int xcorr_fft(const PreparedIQ &a, const PreparedIQ &b, std::vector<double> &corr, double &peak);
+
+// lags lag_lo .. lag_hi of the same correlation (corr[0] = lag lag_lo), the inverse transform
+// only evaluates the requested window (see ifft_window)
+int xcorr_fft_window(const PreparedIQ &a, const PreparedIQ &b, long lag_lo, long lag_hi,
+                     std::vector<double> &corr, double &peak);
+
+// same window from direct time domain dot products, cost (lag_hi - lag_lo + 1) * N
+int xcorr_direct_window(const PreparedIQ &a, const PreparedIQ &b, long lag_lo, long lag_hi,
+                        std::vector<double> &corr, double &peak);
+
+// lag window with the cheaper of xcorr_direct_window and xcorr_fft_window
+int xcorr_window(const PreparedIQ &a, const PreparedIQ &b, long lag_lo, long lag_hi,
+                 std::vector<double> &corr, double &peak);
+
+// correlate_iq.m: cross-correlation, report, smoothing (0 = off) and normalization
+// report = false skips the console line (e.g. for concurrent runs)
+int correlate_iq(const PreparedIQ &a, const PreparedIQ &b, CorrType corr_type, int smoothing_factor,
+                 std::vector<double> &corr, CorrStats &stats, bool report = true);
+
+// correlate_iq after the cross-correlation, for a raw correlation computed elsewhere (e.g. from
+// cached spectra): corr is the full xcorr of a and b, stats.peak its maximum
+int correlate_iq_finish(const PreparedIQ &a, const PreparedIQ &b, CorrType corr_type, int smoothing_factor,
+                        std::vector<double> &corr, CorrStats &stats, bool report = true);
+
+#endif
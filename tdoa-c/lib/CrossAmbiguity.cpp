@@ -0,0 +1,125 @@
+#include "CrossAmbiguity.h"
+#include "FFT.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace
+{
+  // mean free copy in double precision, conjugated for the second signal
+  void remove_mean(const std::complex<float> *x, size_t n, bool conjugate, std::vector<std::complex<double>> &out)
+  {
+    std::complex<double> sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+      sum += std::complex<double>(x[i]);
+    std::complex<double> mean = sum / static_cast<double>(n);
+
+    out.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+      std::complex<double> v = std::complex<double>(x[i]) - mean;
+      out[i] = conjugate ? std::conj(v) : v;
+    }
+  }
+}
+
+int caf_window(const std::complex<float> *a, const std::complex<float> *b, size_t n, long lag_lo, long lag_hi,
+               const CafConfig &config, CafSurface &surface)
+{
+  long ln = static_cast<long>(n);
+  if (n < 2 || lag_lo > lag_hi || lag_lo <= -ln || lag_hi >= ln)
+  {
+    std::cerr << "Error: invalid caf lag window!" << std::endl;
+    return 1;
+  }
+  if (config.sample_rate <= 0.0 || config.max_doppler_hz <= 0.0 || config.doppler_step_hz <= 0.0)
+  {
+    std::cerr << "Error: invalid caf doppler grid!" << std::endl;
+    return 1;
+  }
+
+  // the block sum attenuates max_doppler_hz by less than 1 dB at a decimated rate of 4 * max_doppler_hz
+  size_t d = static_cast<size_t>(std::max(1.0, std::floor(config.sample_rate / (4.0 * config.max_doppler_hz))));
+  size_t blocks = (n + d - 1) / d;
+  double decimated_rate = config.sample_rate / static_cast<double>(d);
+  size_t m = next_pow2(std::max<size_t>(blocks, static_cast<size_t>(std::ceil(decimated_rate / config.doppler_step_hz))));
+  double bin_hz = decimated_rate / static_cast<double>(m);
+  long half_bins = static_cast<long>(std::ceil(config.max_doppler_hz / bin_hz));
+  size_t rows = static_cast<size_t>(2 * half_bins + 1);
+  const FFTPlan &plan = get_fft_plan(m);
+
+  std::vector<std::complex<double>> x, y;
+  remove_mean(a, n, false, x);
+  remove_mean(b, n, true, y);
+
+  surface.lag_lo = lag_lo;
+  surface.num_lags = static_cast<size_t>(lag_hi - lag_lo + 1);
+  surface.doppler_hz.resize(rows);
+  for (size_t r = 0; r < rows; ++r)
+    surface.doppler_hz[r] = static_cast<double>(static_cast<long>(r) - half_bins) * bin_hz;
+  surface.mag.assign(rows * surface.num_lags, 0.0);
+
+  std::atomic<size_t> next_lag(0);
+  auto worker = [&]()
+  {
+    std::vector<std::complex<double>> z(m);
+    for (size_t l = next_lag++; l < surface.num_lags; l = next_lag++)
+    {
+      long lag = lag_lo + static_cast<long>(l);
+      // overlap of a[i + lag] and b[i], block grid aligned to b so all lags share the time origin
+      size_t i_lo = static_cast<size_t>(std::max(0L, -lag));
+      size_t i_hi = static_cast<size_t>(std::min(ln, ln - lag));
+
+      std::fill(z.begin(), z.end(), 0.0);
+      for (size_t blk = i_lo / d; blk * d < i_hi; ++blk)
+      {
+        size_t begin = std::max(i_lo, blk * d);
+        size_t count = std::min(i_hi, (blk + 1) * d) - begin;
+        // begin + lag >= 0 (begin >= i_lo), no pointer before the start of x
+        const double *p = reinterpret_cast<const double *>(x.data() + (static_cast<long>(begin) + lag));
+        const double *q = reinterpret_cast<const double *>(y.data() + begin);
+        double sr = 0.0, si = 0.0;
+        for (size_t k = 0; k < 2 * count; k += 2)
+        {
+          sr += p[k] * q[k] - p[k + 1] * q[k + 1];
+          si += p[k] * q[k + 1] + p[k + 1] * q[k];
+        }
+        z[blk] = std::complex<double>(sr, si);
+      }
+      plan.forward(z);
+
+      for (size_t r = 0; r < rows; ++r)
+      {
+        // forward fft bin k holds exp(+2*pi*i*k*m/M), i.e. a doppler of +k bins
+        size_t k = static_cast<size_t>(static_cast<long>(r) - half_bins + static_cast<long>(m)) & (m - 1);
+        surface.mag[r * surface.num_lags + l] = std::abs(z[k]);
+      }
+    }
+  };
+
+  unsigned num_threads = config.num_threads;
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = static_cast<unsigned>(std::min<size_t>(num_threads, surface.num_lags));
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < num_threads; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+
+  // peak search after the join, first maximum in row major order
+  size_t best = std::max_element(surface.mag.begin(), surface.mag.end()) - surface.mag.begin();
+  surface.peak = surface.mag[best];
+  surface.peak_lag = lag_lo + static_cast<long>(best % surface.num_lags);
+  surface.peak_doppler_hz = surface.doppler_hz[best / surface.num_lags];
+  return 0;
+}
+
+int caf_window(const std::vector<std::complex<float>> &a, const std::vector<std::complex<float>> &b,
+               long lag_lo, long lag_hi, const CafConfig &config, CafSurface &surface)
+{
+  return caf_window(a.data(), b.data(), std::min(a.size(), b.size()), lag_lo, lag_hi, config, surface);
+}
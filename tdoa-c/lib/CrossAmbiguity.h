@@ -0,0 +1,41 @@
+#ifndef CROSS_AMBIGUITY_H
+#define CROSS_AMBIGUITY_H
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+
+struct CafConfig
+{
+  double sample_rate = 2e6;       // Hz
+  double max_doppler_hz = 200.0;  // grid covers -max_doppler_hz .. max_doppler_hz
+  double doppler_step_hz = 1.0;   // requested resolution, the grid step is the next finer fft bin spacing
+  unsigned num_threads = 0;       // 0: all cores
+};
+
+// |CAF(lag, doppler)| = |sum_m a[m + lag] * conj(b[m]) * exp(-2*pi*i*doppler*m/fs)|, means removed
+// positive doppler: the first signal is shifted up in frequency relative to the second
+struct CafSurface
+{
+  long lag_lo;                     // lag of column 0
+  size_t num_lags;
+  std::vector<double> doppler_hz;  // frequency of each row
+  std::vector<double> mag;         // row major, mag[row * num_lags + lag - lag_lo]
+  double peak;                     // maximum of mag
+  long peak_lag;
+  double peak_doppler_hz;
+
+  const double *row(size_t r) const { return mag.data() + r * num_lags; }
+};
+
+// cross-ambiguity function for lags lag_lo .. lag_hi
+// per lag the product a[m + lag] * conj(b[m]) is block summed by D = fs / (4 * max_doppler_hz)
+// (low pass plus decimation) and one small fft of the decimated product gives all doppler bins,
+// cost per lag: n + (n/D) * log2(n/D) instead of a full length correlation per doppler bin
+// meant for the valid lag window around a known delay, lags are processed in parallel
+int caf_window(const std::complex<float> *a, const std::complex<float> *b, size_t n, long lag_lo, long lag_hi,
+               const CafConfig &config, CafSurface &surface);
+int caf_window(const std::vector<std::complex<float>> &a, const std::vector<std::complex<float>> &b,
+               long lag_lo, long lag_hi, const CafConfig &config, CafSurface &surface);
+
+#endif
@@ -0,0 +1,195 @@
+#include "DabTiming.h"
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+  // mode I at 2.048 Msps
+  const double DAB_RATE = 2.048e6;
+  const double DAB_TU = 2048.0;      // useful symbol
+  const double DAB_TG = 504.0;       // cyclic prefix
+  const double DAB_TNULL = 2656.0;   // null symbol
+  const double DAB_FRAME = 196608.0; // 96 ms
+  const int DAB_SYMBOLS = 76;        // symbols after the null symbol
+  const size_t ENVELOPE_BLOCK = 64;
+
+  struct DabGeometry
+  {
+    size_t tu, tg, tnull, frame;
+    double symbol;
+    double null_len;
+  };
+
+  DabGeometry geometry(double sample_rate)
+  {
+    double s = sample_rate / DAB_RATE;
+    DabGeometry g;
+    g.tu = static_cast<size_t>(std::lround(DAB_TU * s));
+    g.tg = static_cast<size_t>(std::lround(DAB_TG * s));
+    g.null_len = DAB_TNULL * s;
+    g.tnull = static_cast<size_t>(std::lround(g.null_len));
+    g.frame = static_cast<size_t>(std::lround(DAB_FRAME * s));
+    g.symbol = (DAB_TU + DAB_TG) * s;
+    return g;
+  }
+
+  // frame phase of one capture, false if no null symbol is found
+  bool frame_phase(const std::complex<float> *x, size_t n, const DabGeometry &g, const DabConfig &config,
+                   std::vector<double> &energy_prefix, double &phase, double &null_depth)
+  {
+    energy_prefix.resize(n + 1);
+    energy_prefix[0] = 0.0;
+    for (size_t i = 0; i < n; ++i)
+      energy_prefix[i + 1] = energy_prefix[i] + std::norm(std::complex<double>(x[i]));
+
+    // running null-length energy folded over the frame
+    size_t windows = n - g.tnull + 1;
+    std::vector<double> fold(g.frame, 0.0);
+    std::vector<unsigned> count(g.frame, 0);
+    for (size_t t = 0; t < windows; ++t)
+    {
+      size_t p = t % g.frame;
+      fold[p] += energy_prefix[t + g.tnull] - energy_prefix[t];
+      ++count[p];
+    }
+    double mean = energy_prefix[n] / static_cast<double>(n) * static_cast<double>(g.tnull);
+    size_t best = 0;
+    double best_energy = std::numeric_limits<double>::infinity();
+    for (size_t p = 0; p < g.frame; ++p)
+    {
+      double e = fold[p] / count[p];
+      if (e < best_energy)
+      {
+        best_energy = e;
+        best = p;
+      }
+    }
+    null_depth = mean > 0.0 ? best_energy / mean : 1.0;
+    if (null_depth > config.max_null_depth)
+      return false;
+
+    // cyclic prefix correlation at every symbol start, running sum over tg, folded over the frame
+    size_t cp_len = n - g.tu - g.tg + 1;
+    std::vector<double> cp_fold(g.frame, 0.0);
+    std::complex<double> acc = 0.0;
+    for (size_t k = 0; k < g.tg; ++k)
+      acc += std::complex<double>(x[k]) * std::conj(std::complex<double>(x[k + g.tu]));
+    for (size_t t = 0; t < cp_len; ++t)
+    {
+      cp_fold[t % g.frame] += std::abs(acc);
+      if (t + 1 < cp_len)
+      {
+        acc += std::complex<double>(x[t + g.tg]) * std::conj(std::complex<double>(x[t + g.tg + g.tu]));
+        acc -= std::complex<double>(x[t]) * std::conj(std::complex<double>(x[t + g.tu]));
+      }
+    }
+
+    long frame = static_cast<long>(g.frame);
+    long best_phase = static_cast<long>(best);
+    double best_score = -1.0;
+    for (long d = -config.search_lags; d <= config.search_lags; ++d)
+    {
+      long start = static_cast<long>(best) + d;
+      double score = 0.0;
+      for (int j = 0; j < DAB_SYMBOLS; ++j)
+      {
+        long s = start + std::lround(g.null_len + j * g.symbol);
+        score += cp_fold[((s % frame) + frame) % frame];
+      }
+      if (score > best_score)
+      {
+        best_score = score;
+        best_phase = start;
+      }
+    }
+    phase = static_cast<double>(((best_phase % frame) + frame) % frame);
+    return true;
+  }
+
+  // normalized correlation of the mean free block energies of a[i + lag] and b[i], 0 if they overlap
+  // by less than half the capture: the null symbols line up at every whole frame lag and dominate a
+  // short overlap, the receivers of a pair are always far closer
+  double envelope_corr(const std::vector<double> &prefix_a, const std::vector<double> &prefix_b, size_t n, long lag)
+  {
+    long ln = static_cast<long>(n);
+    long i_lo = std::max(0L, -lag);
+    long i_hi = std::min(ln, ln - lag);
+    long blocks = (i_hi - i_lo) / static_cast<long>(ENVELOPE_BLOCK);
+    if (blocks < 16 || 2 * (i_hi - i_lo) < ln)
+      return 0.0;
+
+    double sa = 0.0, sb = 0.0, saa = 0.0, sbb = 0.0, sab = 0.0;
+    for (long k = 0; k < blocks; ++k)
+    {
+      long i = i_lo + k * static_cast<long>(ENVELOPE_BLOCK);
+      double ea = prefix_a[i + lag + ENVELOPE_BLOCK] - prefix_a[i + lag];
+      double eb = prefix_b[i + ENVELOPE_BLOCK] - prefix_b[i];
+      sa += ea;
+      sb += eb;
+      saa += ea * ea;
+      sbb += eb * eb;
+      sab += ea * eb;
+    }
+    double nb = static_cast<double>(blocks);
+    double cov = sab - sa * sb / nb;
+    double var = (saa - sa * sa / nb) * (sbb - sb * sb / nb);
+    return var > 0.0 ? cov / std::sqrt(var) : 0.0;
+  }
+}
+
+int dab_timing(const std::complex<float> *a, const std::complex<float> *b, size_t n,
+               const PreparedIQ &prepared_a, const PreparedIQ &prepared_b, const DabConfig &config,
+               LagWindow &window, DabTiming &timing, bool report)
+{
+  DabGeometry g = geometry(config.sample_rate);
+  timing.detected = false;
+  timing.frame_phase1 = timing.frame_phase2 = 0.0;
+  timing.null_depth1 = timing.null_depth2 = 1.0;
+  timing.lag = 0;
+  timing.envelope_corr = 0.0;
+
+  // at least one full frame plus the symbols needed to see the null symbol twice
+  std::vector<double> prefix_a, prefix_b;
+  if (n >= g.frame + g.tnull + g.tu + g.tg &&
+      frame_phase(a, n, g, config, prefix_a, timing.frame_phase1, timing.null_depth1) &&
+      frame_phase(b, n, g, config, prefix_b, timing.frame_phase2, timing.null_depth2))
+  {
+    long frame = static_cast<long>(g.frame);
+    long base = static_cast<long>(timing.frame_phase1 - timing.frame_phase2);
+    base = ((base % frame) + frame) % frame;
+
+    // every lag base + k * frame within the capture is a candidate
+    long ln = static_cast<long>(n);
+    double best_corr = -1.0;
+    long best_lag = 0;
+    for (long lag = base - ((base + ln - 1) / frame) * frame; lag < ln; lag += frame)
+    {
+      if (lag <= -ln)
+        continue;
+      double c = envelope_corr(prefix_a, prefix_b, n, lag);
+      if (c > best_corr)
+      {
+        best_corr = c;
+        best_lag = lag;
+      }
+    }
+    timing.envelope_corr = best_corr;
+    timing.lag = best_lag;
+    timing.detected = best_corr >= config.min_envelope_corr;
+  }
+
+  if (!timing.detected)
+  {
+    if (report)
+      std::cout << "no DAB frame structure detected, using full correlation" << std::endl;
+    window.lag_lo = -(static_cast<long>(std::max(prepared_a.seq.size(), prepared_b.seq.size())) - 1);
+    return xcorr_fft(prepared_a, prepared_b, window.corr, window.peak);
+  }
+
+  long nmax = static_cast<long>(std::max(prepared_a.seq.size(), prepared_b.seq.size()));
+  window.lag_lo = std::max(-(nmax - 1), timing.lag - config.refine_lags);
+  long lag_hi = std::min(nmax - 1, timing.lag + config.refine_lags);
+  return xcorr_direct_window(prepared_a, prepared_b, window.lag_lo, lag_hi, window.corr, window.peak);
+}
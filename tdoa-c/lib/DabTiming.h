@@ -0,0 +1,45 @@
+#ifndef DAB_TIMING_H
+#define DAB_TIMING_H
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include "CorrelateIQ.h"
+#include "CoarseFine.h"
+
+// DAB transmission mode I, durations in samples at 2.048 Msps, scaled to the sample rate
+struct DabConfig
+{
+  double sample_rate = 2e6;
+  double max_null_depth = 0.35;  // folded null energy / mean energy, above -> not a DAB signal
+  double min_envelope_corr = 0.1; // normalized envelope correlation needed to resolve the frame ambiguity
+  long refine_lags = 8;          // direct correlation +- this many lags around the DAB estimate
+  long search_lags = 64;         // cyclic prefix search +- this many samples around the null estimate
+};
+
+struct DabTiming
+{
+  bool detected;        // false: generic full correlation was used
+  double frame_phase1;  // start of the null symbol modulo the frame length, first signal
+  double frame_phase2;
+  double null_depth1;   // folded null energy / mean energy
+  double null_depth2;
+  long lag;             // relative timing from the frame structure (before the direct refinement)
+  double envelope_corr; // normalized envelope correlation of the chosen frame
+};
+
+// relative timing of two captures of a DAB reference transmitter in O(N):
+// 1. null symbol: running energy over the null length folded over the 96 ms frame, minimum = frame start
+// 2. cyclic prefix: running correlation x[t] * conj(x[t + Tu]) over Tg, summed at the symbol starts of
+//    the frame, refines the frame start within +-search_lags
+// 3. the relative frame phase is ambiguous by whole frames, the frame is chosen by the dot product of
+//    the block energy envelopes of both captures (among the lags that overlap by half the capture)
+// 4. xcorr_direct_window of the prepared signals +- refine_lags around the result, so the correlation
+//    (and its peak) is the same as the generic path, only restricted to a few lags
+// without a detected frame structure the full correlation (xcorr_fft) is returned
+// report = false skips the console note of that fallback
+int dab_timing(const std::complex<float> *a, const std::complex<float> *b, size_t n,
+               const PreparedIQ &prepared_a, const PreparedIQ &prepared_b, const DabConfig &config,
+               LagWindow &window, DabTiming &timing, bool report = true);
+
+#endif
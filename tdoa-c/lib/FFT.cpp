@@ -0,0 +1,270 @@
+#include "FFT.h"
+#include "Trace.h"
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+FFTPlan::FFTPlan(size_t n) : n_(n)
+{
+  if (n == 0 || (n & (n - 1)) != 0)
+    throw std::invalid_argument("FFTPlan: size must be a power of two");
+
+  twiddle_.resize(n / 2);
+  for (size_t k = 0; k < n / 2; ++k)
+  {
+    double phi = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(n);
+    twiddle_[k] = std::complex<double>(std::cos(phi), std::sin(phi));
+  }
+
+  // stage tables: exp(-2*pi*i*k/len) for k < len/2 at stage_twiddle_[len/2 - 1 + k]
+  stage_twiddle_.resize(n > 1 ? n - 1 : 0);
+  for (size_t half = 1; half < n; half <<= 1)
+    for (size_t k = 0; k < half; ++k)
+      stage_twiddle_[half - 1 + k] = twiddle_[k * (n / (2 * half))];
+
+  int bits = 0;
+  while ((size_t(1) << bits) < n)
+    ++bits;
+  for (size_t i = 0; i < n; ++i)
+  {
+    size_t j = 0;
+    for (int b = 0; b < bits; ++b)
+      j |= ((i >> b) & 1) << (bits - 1 - b);
+    if (i < j)
+    {
+      swap_.push_back(i);
+      swap_.push_back(j);
+    }
+  }
+  swap_.shrink_to_fit();
+}
+
+namespace
+{
+  // butterflies of one stage (len = 2 * half) over data[0..count), twiddles of the stage in w
+  template <bool INVERSE>
+  void stage(std::complex<double> *data, size_t count, size_t half, const std::complex<double> *w)
+  {
+    for (size_t start = 0; start < count; start += 2 * half)
+    {
+      double *a = reinterpret_cast<double *>(data + start);
+      double *b = a + 2 * half;
+      const double *t = reinterpret_cast<const double *>(w);
+      for (size_t k = 0; k < 2 * half; k += 2)
+      {
+        // explicit complex multiply, std::complex operator* handles inf/nan and is slow
+        double wr = t[k], wi = INVERSE ? -t[k + 1] : t[k + 1];
+        double br = b[k] * wr - b[k + 1] * wi;
+        double bi = b[k] * wi + b[k + 1] * wr;
+        b[k] = a[k] - br;
+        b[k + 1] = a[k + 1] - bi;
+        a[k] += br;
+        a[k + 1] += bi;
+      }
+    }
+  }
+
+  inline std::complex<double> mul(std::complex<double> a, std::complex<double> w)
+  {
+    return std::complex<double>(a.real() * w.real() - a.imag() * w.imag(), a.real() * w.imag() + a.imag() * w.real());
+  }
+
+  // two stages (half and 2*half) in one pass over the data, for the stages that do not fit in cache
+  template <bool INVERSE>
+  void stage_pair(std::complex<double> *data, size_t count, size_t half, const std::complex<double> *w1,
+                  const std::complex<double> *w2)
+  {
+    for (size_t start = 0; start < count; start += 4 * half)
+    {
+      std::complex<double> *x = data + start;
+      for (size_t k = 0; k < half; ++k)
+      {
+        std::complex<double> a = w1[k], b = w2[k], c = w2[k + half];
+        if (INVERSE)
+        {
+          a = std::conj(a);
+          b = std::conj(b);
+          c = std::conj(c);
+        }
+        std::complex<double> x0 = x[k], x1 = x[k + half], x2 = x[k + 2 * half], x3 = x[k + 3 * half];
+        std::complex<double> t = mul(x1, a);
+        std::complex<double> y0 = x0 + t, y1 = x0 - t;
+        t = mul(x3, a);
+        std::complex<double> y2 = x2 + t, y3 = x2 - t;
+        t = mul(y2, b);
+        x[k] = y0 + t;
+        x[k + 2 * half] = y0 - t;
+        t = mul(y3, c);
+        x[k + half] = y1 + t;
+        x[k + 3 * half] = y1 - t;
+      }
+    }
+  }
+
+  // stages up to this length run block by block while the block stays in cache
+  const size_t CACHE_BLOCK = 8192;
+
+  // smaller transforms (e.g. the sub-ffts of ifft_window) are left to the span of their caller
+  const size_t TRACE_MIN_LEN = 65536;
+}
+
+void FFTPlan::transform(std::complex<double> *data, bool inverse) const
+{
+  for (size_t k = 0; k < swap_.size(); k += 2)
+    std::swap(data[swap_[k]], data[swap_[k + 1]]);
+
+  // iterative decimation in time butterflies, the small stages of one block are done together
+  auto run = [&](auto inverse_tag)
+  {
+    constexpr bool INV = decltype(inverse_tag)::value;
+    size_t block = std::min(n_, CACHE_BLOCK);
+    for (size_t b0 = 0; b0 < n_; b0 += block)
+      for (size_t half = 1; half < block; half <<= 1)
+        stage<INV>(data + b0, block, half, stage_twiddle_.data() + half - 1);
+    size_t half = block;
+    for (; 2 * half < n_; half <<= 2)
+      stage_pair<INV>(data, n_, half, stage_twiddle_.data() + half - 1, stage_twiddle_.data() + 2 * half - 1);
+    if (half < n_)
+      stage<INV>(data, n_, half, stage_twiddle_.data() + half - 1);
+  };
+  if (inverse)
+    run(std::true_type());
+  else
+    run(std::false_type());
+}
+
+void FFTPlan::forward(std::complex<double> *data) const
+{
+  TraceSpan span(n_ >= TRACE_MIN_LEN ? "fft" : nullptr);
+  transform(data, false);
+}
+
+void FFTPlan::inverse(std::complex<double> *data) const
+{
+  TraceSpan span(n_ >= TRACE_MIN_LEN ? "ifft" : nullptr);
+  transform(data, true);
+  const double scale = 1.0 / static_cast<double>(n_);
+  for (size_t k = 0; k < n_; ++k)
+    data[k] *= scale;
+}
+
+const FFTPlan &get_fft_plan(size_t n)
+{
+  static std::mutex mutex;
+  static std::map<size_t, std::unique_ptr<FFTPlan>> plans;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = plans.find(n);
+  if (it == plans.end())
+    it = plans.emplace(n, std::make_unique<FFTPlan>(n)).first;
+  return *it->second;
+}
+
+namespace
+{
+  // sub-transform size for ifft_window, 0 if the full inverse fft is cheaper
+  size_t window_block_size(size_t n, size_t count)
+  {
+    auto log2 = [](size_t v)
+    {
+      double b = 0.0;
+      while (v > 1)
+      {
+        v >>= 1;
+        b += 1.0;
+      }
+      return b;
+    };
+
+    // cost in units of n: sub-ffts + gather + recombination (count * n/P complex mac, weighted 2)
+    double full_cost = log2(n) + 1.0;
+    size_t best = 0;
+    double best_cost = full_cost;
+    // very small sub-ffts are dominated by per-call overhead
+    for (size_t p = std::max<size_t>(next_pow2(count), 32); p < n; p <<= 1)
+    {
+      double cost = log2(p) + 1.0 + 2.0 * static_cast<double>(count) / static_cast<double>(p);
+      if (cost < best_cost)
+      {
+        best_cost = cost;
+        best = p;
+      }
+    }
+    return best;
+  }
+}
+
+void ifft_window(const std::complex<double> *spec, size_t n, long first, size_t count, std::complex<double> *out)
+{
+  TraceSpan span("ifft window");
+  const FFTPlan &plan = get_fft_plan(n);
+  size_t start = static_cast<size_t>(((first % static_cast<long>(n)) + static_cast<long>(n)) % static_cast<long>(n));
+  size_t p = window_block_size(n, std::min(count, n));
+
+  if (p == 0)
+  {
+    std::vector<std::complex<double>> full(spec, spec + n);
+    plan.inverse(full);
+    for (size_t j = 0; j < count; ++j)
+      out[j] = full[(start + j) & (n - 1)];
+    return;
+  }
+
+  // k = q*k1 + k2: x[m] = 1/n * sum_k2 W_n^(-k2*m) * sum_k1 C[q*k1 + k2] * W_p^(-k1*m)
+  // the inner sum is p times a p point ifft of the k2-th interleaved sub-spectrum at m mod p
+  size_t q = n / p;
+  const FFTPlan &plan_p = get_fft_plan(p);
+  std::fill(out, out + count, 0.0);
+
+  // sub-spectra are gathered in groups so every row of spec is read contiguously
+  const size_t group = std::min<size_t>(8, q);
+  std::vector<std::complex<double>> sub(group * p);
+
+  for (size_t k2_0 = 0; k2_0 < q; k2_0 += group)
+  {
+    for (size_t k1 = 0; k1 < p; ++k1)
+    {
+      const std::complex<double> *row = spec + q * k1 + k2_0;
+      for (size_t g = 0; g < group; ++g)
+        sub[g * p + k1] = row[g];
+    }
+
+    for (size_t g = 0; g < group; ++g)
+    {
+      size_t k2 = k2_0 + g;
+      std::complex<double> *inner = sub.data() + g * p;
+      plan_p.inverse(inner);
+
+      // exp(+2*pi*i*k2*m/n) advanced by one rotation per output, re-anchored from the table
+      const std::complex<double> step = std::conj(plan.twiddle(k2));
+      std::complex<double> w;
+      for (size_t j = 0; j < count; ++j)
+      {
+        size_t m = start + j;
+        if ((j & 63) == 0)
+          w = std::conj(plan.twiddle(k2 * m));
+        const std::complex<double> v = inner[m & (p - 1)];
+        out[j] += std::complex<double>(v.real() * w.real() - v.imag() * w.imag(),
+                                       v.real() * w.imag() + v.imag() * w.real());
+        w = std::complex<double>(w.real() * step.real() - w.imag() * step.imag(),
+                                 w.real() * step.imag() + w.imag() * step.real());
+      }
+    }
+  }
+
+  const double scale = 1.0 / static_cast<double>(q);
+  for (size_t j = 0; j < count; ++j)
+    out[j] *= scale;
+}
+
+size_t next_pow2(size_t n)
+{
+  size_t p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
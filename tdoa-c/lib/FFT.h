@@ -0,0 +1,57 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+
+// radix-2 FFT for power of two lengths, twiddles and bit reversal are precomputed once per size
+class FFTPlan
+{
+public:
+  explicit FFTPlan(size_t n);
+
+  size_t size() const { return n_; }
+
+  // memory of the twiddle and bit reversal tables (about 32 bytes per point)
+  size_t bytes() const
+  {
+    return (twiddle_.capacity() + stage_twiddle_.capacity()) * sizeof(std::complex<double>) + swap_.capacity() * sizeof(size_t);
+  }
+
+  // in-place transforms, inverse is scaled by 1/n like MATLAB ifft
+  void forward(std::complex<double> *data) const;
+  void inverse(std::complex<double> *data) const;
+  void forward(std::vector<std::complex<double>> &data) const { forward(data.data()); }
+  void inverse(std::vector<std::complex<double>> &data) const { inverse(data.data()); }
+
+  // exp(-2*pi*i*r/n) for any r
+  std::complex<double> twiddle(size_t r) const
+  {
+    r &= n_ - 1;
+    return (r < n_ / 2) ? twiddle_[r] : -twiddle_[r - n_ / 2];
+  }
+
+private:
+  void transform(std::complex<double> *data, bool inverse) const;
+
+  size_t n_;
+  std::vector<std::complex<double>> twiddle_; // exp(-2*pi*i*k/n), k < n/2
+  std::vector<std::complex<double>> stage_twiddle_; // contiguous twiddles per stage
+  std::vector<size_t> swap_;                  // bit reversal pairs (i, j) with i < j
+};
+
+// shared plan for size n (n must be a power of two), created on first use
+const FFTPlan &get_fft_plan(size_t n);
+
+// window of the inverse transform: out[j] = ifft(spec)[(first + j) mod n], j < count
+// for small windows the spectrum is split into n/P interleaved sub-spectra of size P >= count,
+// each is inverse transformed with a P point fft and only the requested outputs are recombined
+// (n*log2(P) instead of n*log2(n)), the full inverse fft is used when that is cheaper
+// both paths compute the same sums, results agree to rounding precision
+void ifft_window(const std::complex<double> *spec, size_t n, long first, size_t count, std::complex<double> *out);
+
+// smallest power of two >= n
+size_t next_pow2(size_t n);
+
+#endif
@@ -1,5 +1,7 @@
 #include "FilterIQ.h"
+#include "Trace.h"
 #include <cmath>
+#include <algorithm>
 
 // Filter coefficients (diambil dari hasil MATLAB)
 std::vector<float> get_filter_coeffs(int bandwidth_khz)
@@ -19,8 +21,28 @@ std::vector<float> get_filter_coeffs(int bandwidth_khz)
   }
 }
 
-int filter_iq(const std::vector<std::complex<float>> &signal_iq, std::vector<std::complex<float>> &filtered_signal, int signal_bandwidth_khz)
+void fir_filter(const std::complex<float> *x, size_t m, const std::vector<float> &b, std::complex<float> *y)
 {
+  std::fill(y, y + m, std::complex<float>(0.0f, 0.0f));
+
+  // FIR filtering (konvolusi sederhana), in blocks of outputs that stay in cache, tap by tap inside
+  const size_t BLOCK = 4096;
+  const size_t N = b.size();
+  for (size_t n0 = 0; n0 < m; n0 += BLOCK)
+  {
+    size_t n1 = std::min(m, n0 + BLOCK);
+    for (size_t k = 0; k < N; ++k)
+    {
+      const float bk = b[k];
+      for (size_t n = std::max(n0, k); n < n1; ++n)
+        y[n] += x[n - k] * bk;
+    }
+  }
+}
+
+int filter_iq(std::span<const std::complex<float>> signal_iq, std::vector<std::complex<float>> &filtered_signal, int signal_bandwidth_khz, bool report)
+{
+  TraceSpan span("filter");
   auto b = get_filter_coeffs(signal_bandwidth_khz);
 
   if (b.empty())
@@ -29,21 +51,14 @@ int filter_iq(const std::vector<std::complex<float>> &signal_iq, std::vector<std
     return 1;
   }
 
-  size_t N = b.size();
-  size_t M = signal_iq.size();
-  // std::vector<std::complex<float>> filtered_signal(M, 0);
-
-  // FIR filtering (konvolusi sederhana)
-  for (size_t n = 0; n < M; ++n)
-  {
-    for (size_t k = 0; k < N; ++k)
-    {
-      if (n >= k)
-      {
-        filtered_signal[n] += signal_iq[n - k] * b[k];
-      }
-    }
-  }
+  filtered_signal.resize(signal_iq.size());
+  fir_filter(signal_iq.data(), signal_iq.size(), b, filtered_signal.data());
 
+  if (!report)
+    return 0;
+  if (signal_bandwidth_khz == 12)
+    std::cout << "Signal filtered to 12.5 kHz" << std::endl;
+  else
+    std::cout << "Signal filtered to " << signal_bandwidth_khz << " kHz" << std::endl;
   return 0;
 }
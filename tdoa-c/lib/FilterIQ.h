@@ -5,8 +5,20 @@
 #include <cmath>
 #include <vector>
 #include <complex>
+#include <span>
 
-int FilterIQ(std::vector<unsigned char> signal_iq, unsigned int signal_bandwidth_khz);
-void firpmord(const std::vector<double> &f, const std::vector<double> &a, const std::vector<double> &dev, double fs, int &N, std::vector<double> &fo, std::vector<double> &ao, std::vector<double> &w);
+// filter_iq.m: FIR low pass to the signal bandwidth (400, 200, 40, 12 kHz) with the firpm
+// coefficients from MATLAB, same output as filter(b, 1, x) (zero initial state)
+// filtered_signal is resized to the input length, returns 1 for any other bandwidth
+// report = false skips the "Signal filtered" line
+int filter_iq(std::span<const std::complex<float>> signal_iq, std::vector<std::complex<float>> &filtered_signal, int signal_bandwidth_khz,
+              bool report = true);
 
-#endif
\ No newline at end of file
+// coefficients of filter_iq, empty for any other bandwidth
+std::vector<float> get_filter_coeffs(int bandwidth_khz);
+
+// the FIR of filter_iq on m samples: y[i] = sum_k b[k] * x[i - k] over the taps with i >= k
+// (callers that filter a stream in chunks put the last b.size()-1 inputs in front of each chunk)
+void fir_filter(const std::complex<float> *x, size_t m, const std::vector<float> &b, std::complex<float> *y);
+
+#endif
@@ -0,0 +1,53 @@
+#include "FindPeaks.h"
+#include "PeakHeap.h"
+#include <algorithm>
+
+namespace
+{
+  // true if no value within +-sep is larger (left: larger or equal) than corr[i]
+  bool dominates(const double *corr, size_t n, size_t i, size_t sep)
+  {
+    double v = corr[i];
+    size_t lo = (i > sep) ? i - sep : 0;
+    size_t hi = std::min(n - 1, i + sep);
+    for (size_t j = lo; j < i; ++j)
+      if (corr[j] >= v)
+        return false;
+    for (size_t j = i + 1; j <= hi; ++j)
+      if (corr[j] > v)
+        return false;
+    return true;
+  }
+}
+
+size_t find_peaks(const double *corr, size_t n, size_t max_peaks, size_t min_separation, PeakFit fit, CorrPeak *peaks)
+{
+  if (max_peaks == 0)
+    return 0;
+  PeakHeap<MAX_CORR_PEAKS> heap(max_peaks);
+  size_t sep = std::max<size_t>(min_separation, 1);
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    double v = corr[i];
+    if (heap.full() && v <= heap.threshold())
+      continue;
+    // cheap local maximum test first, the separation test is bounded by 2*sep
+    if ((i > 0 && corr[i - 1] >= v) || (i + 1 < n && corr[i + 1] > v))
+      continue;
+    if (dominates(corr, n, i, sep))
+      heap.push(v, i);
+  }
+
+  size_t count = heap.sort_descending();
+  for (size_t k = 0; k < count; ++k)
+  {
+    PeakEstimate estimate;
+    refine_peak(corr, n, heap[k].index, fit, estimate);
+    peaks[k].idx = heap[k].index;
+    peaks[k].position = estimate.position;
+    peaks[k].amplitude = estimate.amplitude;
+    peaks[k].variance = estimate.variance;
+  }
+  return count;
+}
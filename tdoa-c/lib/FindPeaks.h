@@ -0,0 +1,25 @@
+#ifndef FIND_PEAKS_H
+#define FIND_PEAKS_H
+
+#include <cstddef>
+#include "PeakRefine.h"
+
+const size_t MAX_CORR_PEAKS = 32;
+
+struct CorrPeak
+{
+  size_t idx;       // integer index of the local maximum
+  double position;  // interpolated fractional index
+  double amplitude; // interpolated value
+  double variance;  // variance of position in samples^2
+};
+
+// K best local maxima of a correlation (or lag window), strongest first, for multipath hypotheses
+// a local maximum only counts if no larger value lies within +-min_separation (the first of
+// equal values wins), positions and amplitudes are refined with 'fit'
+// one pass over corr with a fixed size heap, the separation check only runs for candidates that
+// would enter the heap, nothing is allocated (except the small buffers of PEAK_FIT_FFT_UPSAMPLE)
+// peaks: caller storage for max_peaks entries (max_peaks <= MAX_CORR_PEAKS), returns the number found
+size_t find_peaks(const double *corr, size_t n, size_t max_peaks, size_t min_separation, PeakFit fit, CorrPeak *peaks);
+
+#endif
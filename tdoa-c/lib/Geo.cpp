@@ -0,0 +1,27 @@
+#include "Geo.h"
+#include <cmath>
+
+void latlong2xy(double lat, double lon, double ref_lat, double ref_lon, double &x, double &y)
+{
+  y = (lat - ref_lat) / 360.0 * EARTH_CIRCUMF_KM;
+  x = (lon - ref_lon) / 360.0 * std::cos(ref_lat * M_PI / 180.0) * EARTH_CIRCUMF_KM;
+}
+
+void xy2latlong(double x, double y, double ref_lat, double ref_lon, double &lat, double &lon)
+{
+  lat = (y * 360.0 / EARTH_CIRCUMF_KM) + ref_lat;
+  lon = ((x * 360.0) / (EARTH_CIRCUMF_KM * std::cos(ref_lat * M_PI / 180.0))) + ref_lon;
+}
+
+double dist_latlong(double lat1, double lon1, double lat2, double lon2, double ref_lat, double ref_lon)
+{
+  double x1, y1, x2, y2;
+  latlong2xy(lat1, lon1, ref_lat, ref_lon, x1, y1);
+  latlong2xy(lat2, lon2, ref_lat, ref_lon, x2, y2);
+  return 1000.0 * std::sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2));
+}
+
+double dist_latlong(const LatLong &p1, const LatLong &p2, const LatLong &ref)
+{
+  return dist_latlong(p1.lat, p1.lon, p2.lat, p2.lon, ref.lat, ref.lon);
+}
@@ -0,0 +1,23 @@
+#ifndef GEO_H
+#define GEO_H
+
+// plane approximation of the earth surface around a geodetic reference point (latlong2xy.m)
+const double EARTH_CIRCUMF_KM = 40074.0;
+
+struct LatLong
+{
+  double lat;
+  double lon;
+};
+
+// lat/long to cartesian x, y in km
+void latlong2xy(double lat, double lon, double ref_lat, double ref_lon, double &x, double &y);
+
+// cartesian x, y in km to lat/long
+void xy2latlong(double x, double y, double ref_lat, double ref_lon, double &lat, double &lon);
+
+// distance in meters, accurate only in the (wide) area around the reference point
+double dist_latlong(double lat1, double lon1, double lat2, double lon2, double ref_lat, double ref_lon);
+double dist_latlong(const LatLong &p1, const LatLong &p2, const LatLong &ref);
+
+#endif
@@ -0,0 +1,95 @@
+#include "Heatmap.h"
+#include "Trace.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+  const double LAT_SPAN = 0.03;
+  const double LONG_SPAN = 0.03;
+
+  // linspace(start, stop, n)
+  std::vector<double> linspace(double start, double stop, int n)
+  {
+    std::vector<double> v(static_cast<size_t>(n));
+    for (int i = 0; i < n; ++i)
+      v[i] = n > 1 ? start + (stop - start) * i / (n - 1) : stop;
+    return v;
+  }
+}
+
+int create_heatmap(const std::vector<LatLong> &rx, const std::vector<PairTdoa> &doa, int resolution,
+                   const LatLong &geo_ref, Heatmap &heatmap, unsigned num_threads, bool report)
+{
+  if (resolution < 1 || doa.empty())
+  {
+    std::cerr << "Error: heatmap needs a resolution > 0 and at least one TDOA!" << std::endl;
+    return 1;
+  }
+  for (const PairTdoa &p : doa)
+    if (p.rx1 >= rx.size() || p.rx2 >= rx.size())
+    {
+      std::cerr << "Error: heatmap TDOA of unknown receiver " << std::max(p.rx1, p.rx2) + 1 << std::endl;
+      return 1;
+    }
+  if (report)
+    std::cout << "creating heatmap... " << std::endl;
+  TraceSpan span("heatmap");
+
+  const size_t num_points = static_cast<size_t>(resolution);
+  heatmap.start_lat = geo_ref.lat - LAT_SPAN;
+  heatmap.stop_lat = geo_ref.lat + LAT_SPAN;
+  heatmap.start_long = geo_ref.lon - LONG_SPAN;
+  heatmap.stop_long = geo_ref.lon + LONG_SPAN;
+  heatmap.lat = linspace(heatmap.start_lat, heatmap.stop_lat, resolution);
+  heatmap.lon = linspace(heatmap.start_long, heatmap.stop_long, resolution);
+  heatmap.mag.assign(num_points * num_points, 0.0);
+
+  // 1 / squared error, an exact hit is clamped to the largest finite value
+  std::atomic<size_t> next{0};
+  auto worker = [&]()
+  {
+    std::vector<double> dist(rx.size());
+    for (size_t lon_idx = next++; lon_idx < num_points; lon_idx = next++)
+      for (size_t lat_idx = 0; lat_idx < num_points; ++lat_idx)
+      {
+        LatLong point = {heatmap.lat[lat_idx], heatmap.lon[lon_idx]};
+        for (size_t r = 0; r < rx.size(); ++r)
+          dist[r] = dist_latlong(point, rx[r], geo_ref);
+
+        double doa_error = 0.0;
+        for (const PairTdoa &p : doa)
+        {
+          double e = (dist[p.rx1] - dist[p.rx2]) - p.doa_meters;
+          doa_error += e * e;
+        }
+        heatmap.mag[lon_idx * num_points + lat_idx] = 1.0 / std::max(doa_error, std::numeric_limits<double>::min());
+      }
+  };
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < std::min<size_t>(num_threads, num_points); ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+
+  size_t peak = std::max_element(heatmap.mag.begin(), heatmap.mag.end()) - heatmap.mag.begin();
+  double mag_max = heatmap.mag[peak];
+  if (report)
+  {
+    std::cout << "max(max(mse_doa)) =>" << mag_max << std::endl;
+    std::cout << "1/max(max(mse_doa)) =>" << 1.0 / mag_max << std::endl;
+  }
+  for (double &v : heatmap.mag)
+    v /= mag_max;
+  heatmap.peak = {heatmap.lat[peak % num_points], heatmap.lon[peak / num_points]};
+
+  if (report)
+    std::cout << "creating heatmap done! " << std::endl;
+  return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <vector>
+#include <cstddef>
+#include "Geo.h"
+
+// measured TDOA of the receiver pair rx1, rx2 (0 based): how much rx1 is later than rx2, in meters
+struct PairTdoa
+{
+  size_t rx1;
+  size_t rx2;
+  double doa_meters;
+};
+
+struct Heatmap
+{
+  std::vector<double> lat;  // resolution points from start_lat to stop_lat
+  std::vector<double> lon;  // resolution points from start_long to stop_long
+  std::vector<double> mag;  // mag[long_idx * resolution + lat_idx], 0..1 (mse_doa(long_idx, lat_idx))
+  double start_lat, stop_lat, start_long, stop_long;
+  LatLong peak;             // point with magnitude 1
+};
+
+// create_heatmap.m for any number of receivers and pairs: 1 / sum over the pairs of the squared
+// TDOA error, normalized to a maximum of 1, on a +-0.03 degree grid around geo_ref
+// the distances to the receivers are computed once per grid point, rows run in parallel (num_threads 0: all cores)
+// report = false skips the console lines
+int create_heatmap(const std::vector<LatLong> &rx, const std::vector<PairTdoa> &doa, int resolution,
+                   const LatLong &geo_ref, Heatmap &heatmap, unsigned num_threads = 0, bool report = true);
+
+#endif
@@ -0,0 +1,59 @@
+#include "LagPrior.h"
+#include "CorrReliability.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+int xcorr_prior(const PreparedIQ &a, const PreparedIQ &b, const LagPrior &prior, const PriorSearchConfig &config,
+                long valid_lo, long valid_hi, LagWindow &window, double &reliability, int &widenings, bool report)
+{
+  auto correlate = [&a, &b](long lag_lo, long lag_hi, std::vector<double> &corr, double &peak)
+  {
+    return xcorr_window(a, b, lag_lo, lag_hi, corr, peak);
+  };
+  return xcorr_prior(correlate, prior, config, valid_lo, valid_hi, window, reliability, widenings, report);
+}
+
+int xcorr_prior(const LagCorrelator &correlate, const LagPrior &prior, const PriorSearchConfig &config,
+                long valid_lo, long valid_hi, LagWindow &window, double &reliability, int &widenings, bool report)
+{
+  if (valid_lo > valid_hi)
+  {
+    std::cerr << "Error: empty valid lag range!" << std::endl;
+    return 1;
+  }
+
+  long center = std::lround(prior.center);
+  double half = std::max(static_cast<double>(config.min_half_width), std::ceil(prior.tolerance));
+  widenings = 0;
+
+  while (true)
+  {
+    bool full = widenings > config.max_widenings;
+    long h = static_cast<long>(half) + config.margin;
+    long lo = full ? valid_lo : std::max(valid_lo, std::min(valid_hi, center - h));
+    long hi = full ? valid_hi : std::min(valid_hi, std::max(valid_lo, center + h));
+
+    window.lag_lo = lo;
+    if (correlate(lo, hi, window.corr, window.peak))
+      return 1;
+
+    ReliabilityMetrics metrics;
+    if (corr_reliability_metrics(window.corr, 0, metrics))
+      return 1;
+    reliability = metrics.reliability;
+
+    // a maximum on an inner edge means the correlation is still rising outside the window
+    long peak_lag = lo + static_cast<long>(metrics.peak_idx);
+    bool on_edge = (peak_lag == lo && lo > valid_lo) || (peak_lag == hi && hi < valid_hi);
+    bool covers_all = lo == valid_lo && hi == valid_hi;
+    if (covers_all || (!on_edge && reliability >= config.min_reliability))
+      return 0;
+
+    ++widenings;
+    half *= config.widen_factor;
+    if (report)
+      std::cout << "prior window +-" << h << " unreliable (" << reliability << (on_edge ? ", peak on edge" : "")
+                << "), widening" << std::endl;
+  }
+}
@@ -0,0 +1,49 @@
+#ifndef LAG_PRIOR_H
+#define LAG_PRIOR_H
+
+#include <cstddef>
+#include <vector>
+#include <functional>
+#include "CorrelateIQ.h"
+#include "CoarseFine.h"
+
+// expected delay of a receiver pair, e.g. the previous fix of a fixed emitter or a tracker posterior
+struct LagPrior
+{
+  double center;    // expected lag in samples
+  double tolerance; // searched lags center +- tolerance
+};
+
+// prior from a tracker posterior, mean +- k standard deviations
+inline LagPrior lag_prior_from_posterior(double mean, double sigma, double k = 3.0)
+{
+  return LagPrior{mean, k * sigma};
+}
+
+struct PriorSearchConfig
+{
+  long min_half_width = 32;     // smallest searched half window, enough sidelobes for the reliability
+  long margin = 0;              // extra lags on both sides (e.g. half smoothing span)
+  double min_reliability = 0.5; // corr_reliability of the window below this -> widen
+  double widen_factor = 4.0;    // half window growth per step
+  int max_widenings = 3;        // afterwards the whole valid range is searched
+};
+
+// raw correlation of the lags lag_lo .. lag_hi (corr[0] = lag lag_lo) and its maximum, e.g. xcorr_window
+using LagCorrelator = std::function<int(long lag_lo, long lag_hi, std::vector<double> &corr, double &peak)>;
+
+// correlation restricted to the prior window (xcorr_window), widened while the reliability is below
+// min_reliability or the maximum lies on a window edge that is not the end of the valid range
+// valid_lo .. valid_hi: lags that may be searched at all (e.g. the valid window of tdoa2.m)
+// reliability: corr_reliability of the returned window, widenings: number of widening steps
+// report = false skips the console note of every widening
+int xcorr_prior(const PreparedIQ &a, const PreparedIQ &b, const LagPrior &prior, const PriorSearchConfig &config,
+                long valid_lo, long valid_hi, LagWindow &window, double &reliability, int &widenings,
+                bool report = true);
+
+// same search with another correlation of the windows (e.g. block by block within a memory budget)
+int xcorr_prior(const LagCorrelator &correlate, const LagPrior &prior, const PriorSearchConfig &config,
+                long valid_lo, long valid_hi, LagWindow &window, double &reliability, int &widenings,
+                bool report = true);
+
+#endif
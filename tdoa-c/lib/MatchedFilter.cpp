@@ -0,0 +1,130 @@
+#include "MatchedFilter.h"
+#include "FFT.h"
+#include "ReadIQ.h"
+#include <iostream>
+#include <memory>
+#include <algorithm>
+
+TemplateCache::TemplateCache(const std::vector<std::complex<float>> &waveform)
+{
+  std::complex<double> sum = 0.0;
+  for (const std::complex<float> &v : waveform)
+    sum += std::complex<double>(v);
+  std::complex<double> mean = waveform.empty() ? 0.0 : sum / static_cast<double>(waveform.size());
+
+  template_.resize(waveform.size());
+  energy_ = 0.0;
+  for (size_t i = 0; i < waveform.size(); ++i)
+  {
+    template_[i] = std::complex<double>(waveform[i]) - mean;
+    energy_ += std::norm(template_[i]);
+  }
+}
+
+int TemplateCache::spectrum(size_t len, const std::vector<std::complex<double>> *&spec_out)
+{
+  if (len < template_.size() || len == 0 || (len & (len - 1)) != 0)
+  {
+    std::cerr << "Error: template spectrum length " << len << " is no power of two >= " << template_.size() << std::endl;
+    return 1;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = spectra_.find(len);
+  if (it == spectra_.end())
+  {
+    std::vector<std::complex<double>> spec(len, 0.0);
+    std::copy(template_.begin(), template_.end(), spec.begin());
+    get_fft_plan(len).forward(spec);
+    for (std::complex<double> &v : spec)
+      v = std::conj(v);
+    it = spectra_.emplace(len, std::move(spec)).first;
+  }
+  spec_out = &it->second;
+  return 0;
+}
+
+int matched_filter(const std::complex<float> *x, size_t n, TemplateCache &cache, long first, long last,
+                   PeakFit fit, Arrival &arrival, int upsample)
+{
+  size_t tl = cache.length();
+  if (tl == 0 || n < tl)
+  {
+    std::cerr << "Error: signal shorter than the matched filter template!" << std::endl;
+    return 1;
+  }
+  if (first > last || first <= -static_cast<long>(tl) || last >= static_cast<long>(n))
+  {
+    std::cerr << "Error: invalid matched filter window!" << std::endl;
+    return 1;
+  }
+
+  // linear correlation for positions -(tl-1) .. n-1 without circular wrap
+  size_t len = next_pow2(n + tl - 1);
+  const std::vector<std::complex<double>> *spec;
+  if (cache.spectrum(len, spec))
+    return 1;
+  const std::vector<std::complex<double>> &tspec = *spec;
+
+  std::vector<std::complex<double>> z(len, 0.0);
+  for (size_t i = 0; i < n; ++i)
+    z[i] = std::complex<double>(x[i]);
+  get_fft_plan(len).forward(z);
+  for (size_t k = 0; k < len; ++k)
+    z[k] *= tspec[k];
+
+  size_t count = static_cast<size_t>(last - first + 1);
+  std::vector<std::complex<double>> window(count);
+  ifft_window(z.data(), len, first, count, window.data());
+
+  arrival.first = first;
+  arrival.mag.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    arrival.mag[i] = std::abs(window[i]);
+
+  size_t idx = std::max_element(arrival.mag.begin(), arrival.mag.end()) - arrival.mag.begin();
+  PeakEstimate estimate;
+  if (refine_peak(arrival.mag, idx, fit, estimate, 0.0, upsample))
+    return 1;
+  arrival.position = static_cast<double>(first) + estimate.position;
+  arrival.peak = estimate.amplitude;
+  arrival.variance = estimate.variance;
+  return 0;
+}
+
+int matched_filter_arrival(std::span<const std::complex<float>> x, TemplateCache &cache, PeakFit fit, Arrival &arrival,
+                           int upsample)
+{
+  long last = static_cast<long>(x.size()) - static_cast<long>(cache.length());
+  return matched_filter(x.data(), x.size(), cache, 0, last, fit, arrival, upsample);
+}
+
+int matched_filter_delay(std::span<const std::complex<float>> signal1, std::span<const std::complex<float>> signal2,
+                         TemplateCache &cache, PeakFit fit, double &delay, Arrival &arrival1, Arrival &arrival2,
+                         int upsample)
+{
+  if (matched_filter_arrival(signal1, cache, fit, arrival1, upsample) ||
+      matched_filter_arrival(signal2, cache, fit, arrival2, upsample))
+    return 1;
+
+  delay = arrival1.position - arrival2.position;
+  return 0;
+}
+
+TemplateCache *template_cache(const std::string &filename)
+{
+  static std::mutex mutex;
+  static std::map<std::string, std::unique_ptr<TemplateCache>> caches;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = caches.find(filename);
+  if (it == caches.end())
+  {
+    std::vector<std::complex<float>> waveform;
+    if (ReadIQ(filename, waveform, false) || waveform.empty())
+    {
+      std::cerr << "Error: matched filter template " << filename << " cannot be read!" << std::endl;
+      return nullptr;
+    }
+    it = caches.emplace(filename, std::make_unique<TemplateCache>(waveform)).first;
+  }
+  return it->second.get();
+}
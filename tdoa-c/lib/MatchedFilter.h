@@ -0,0 +1,69 @@
+#ifndef MATCHED_FILTER_H
+#define MATCHED_FILTER_H
+
+#include <vector>
+#include <complex>
+#include <span>
+#include <string>
+#include <map>
+#include <mutex>
+#include <cstddef>
+#include "PeakRefine.h"
+
+// matched filter timing against a known transmit waveform, the measurement of the tdoa2 engines with
+// template_file (Tdoa2Config::measure_template)
+
+// known transmit waveform (preamble, pilot burst) with its spectra per fft size
+// the spectra are computed on first use and kept for the lifetime of the cache, so a cache that
+// outlives one capture makes the template cost a single lookup per receiver
+class TemplateCache
+{
+public:
+  // the template mean is removed, so a dc offset of the receiver does not correlate
+  explicit TemplateCache(const std::vector<std::complex<float>> &waveform);
+
+  size_t length() const { return template_.size(); }
+  double energy() const { return energy_; }
+  const std::vector<std::complex<double>> &waveform() const { return template_; } // mean free
+
+  // conj(fft(template, len)) in spec, returns 1 unless len is a power of two >= length()
+  int spectrum(size_t len, const std::vector<std::complex<double>> *&spec);
+
+private:
+  std::vector<std::complex<double>> template_;
+  double energy_;
+  std::mutex mutex_;
+  std::map<size_t, std::vector<std::complex<double>>> spectra_; // nodes are stable, references stay valid
+};
+
+// matched filter output of one receiver for template start positions first .. last
+struct Arrival
+{
+  long first;               // start position of mag[0]
+  std::vector<double> mag;  // |sum_k x[m + k] * conj(t[k])|
+  double position;          // interpolated start of the template in x (samples)
+  double peak;              // interpolated maximum of mag
+  double variance;          // variance of position in samples^2
+};
+
+// one forward fft of x, multiplication with the cached template spectrum and an inverse
+// transform restricted to first .. last (ifft_window), upsample: factor of PEAK_FIT_FFT_UPSAMPLE
+int matched_filter(const std::complex<float> *x, size_t n, TemplateCache &cache, long first, long last,
+                   PeakFit fit, Arrival &arrival, int upsample = 8);
+
+// arrival over all template positions 0 .. x.size() - length()
+int matched_filter_arrival(std::span<const std::complex<float>> x, TemplateCache &cache, PeakFit fit, Arrival &arrival,
+                           int upsample = 8);
+
+// per receiver arrivals over all template positions and their difference
+// delay > 0: the template arrives later in the first signal (same sign as the cross-correlation delay)
+int matched_filter_delay(std::span<const std::complex<float>> signal1, std::span<const std::complex<float>> signal2,
+                         TemplateCache &cache, PeakFit fit, double &delay, Arrival &arrival1, Arrival &arrival2,
+                         int upsample = 8);
+
+// the cache of an iq file (ReadIQ), read on the first call and kept until the process ends, so a long
+// running process (tdoa-watch, tdoa-batch) computes the template spectra once for all captures
+// null if the file cannot be read or is empty
+TemplateCache *template_cache(const std::string &filename);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <string>
+#include <map>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+// thread safe memo of one stage (node type) of a dependency graph, keyed by the stage parameters
+// the first caller of a key computes the value, concurrent callers of the same key wait for it
+// compute(T &value) returns 0 on success, a failed node stays failed (nullptr) for all callers
+// values are never evicted, a node depending on others fetches them inside compute (acyclic)
+template <typename T>
+class Memo
+{
+public:
+  template <typename Compute>
+  std::shared_ptr<const T> get(const std::string &key, Compute compute)
+  {
+    std::promise<std::shared_ptr<const T>> promise;
+    std::shared_future<std::shared_ptr<const T>> future;
+    bool owner = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = nodes_.find(key);
+      if (it == nodes_.end())
+      {
+        future = promise.get_future().share();
+        nodes_.emplace(key, future);
+        owner = true;
+      }
+      else
+        future = it->second;
+    }
+
+    if (owner)
+    {
+      auto value = std::make_shared<T>();
+      if (compute(*value))
+        promise.set_value(nullptr);
+      else
+        promise.set_value(std::move(value));
+      ++computed_;
+    }
+    else
+      ++reused_;
+    return future.get();
+  }
+
+  size_t computed() const { return computed_; }
+  size_t reused() const { return reused_; }
+
+private:
+  std::mutex mutex_;
+  std::map<std::string, std::shared_future<std::shared_ptr<const T>>> nodes_;
+  std::atomic<size_t> computed_{0};
+  std::atomic<size_t> reused_{0};
+};
+
+#endif
@@ -0,0 +1,21 @@
+#include "MemoryBudget.h"
+
+void MemoryBudget::charge(size_t bytes)
+{
+  size_t used = used_.load();
+  do
+  {
+    if (bytes > limit_ || used > limit_ - bytes)
+      throw std::bad_alloc();
+  } while (!used_.compare_exchange_weak(used, used + bytes));
+
+  size_t peak = peak_.load();
+  while (used + bytes > peak && !peak_.compare_exchange_weak(peak, used + bytes))
+  {
+  }
+}
+
+void MemoryBudget::release(size_t bytes)
+{
+  used_ -= bytes;
+}
@@ -0,0 +1,90 @@
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstddef>
+
+// hard memory limit of the budgeted engine (BudgetPairs.h): every tracked buffer is charged before
+// it is allocated, a charge beyond the limit throws std::bad_alloc (turned into an error status by
+// the engine), peak() is the high water mark of the tracked bytes
+class MemoryBudget
+{
+public:
+  explicit MemoryBudget(size_t limit_bytes) : limit_(limit_bytes) {}
+
+  void charge(size_t bytes);
+  void release(size_t bytes);
+
+  size_t limit() const { return limit_; }
+  size_t used() const { return used_; }
+  size_t peak() const { return peak_; }
+
+private:
+  size_t limit_;
+  std::atomic<size_t> used_{0};
+  std::atomic<size_t> peak_{0};
+};
+
+// std allocator that charges a MemoryBudget
+template <typename T>
+class BudgetAllocator
+{
+public:
+  using value_type = T;
+
+  explicit BudgetAllocator(MemoryBudget &budget) : budget_(&budget) {}
+  template <typename U>
+  BudgetAllocator(const BudgetAllocator<U> &other) : budget_(other.budget()) {}
+
+  T *allocate(size_t n)
+  {
+    budget_->charge(n * sizeof(T));
+    try
+    {
+      return std::allocator<T>().allocate(n);
+    }
+    catch (...)
+    {
+      budget_->release(n * sizeof(T));
+      throw;
+    }
+  }
+
+  void deallocate(T *p, size_t n)
+  {
+    std::allocator<T>().deallocate(p, n);
+    budget_->release(n * sizeof(T));
+  }
+
+  MemoryBudget *budget() const { return budget_; }
+
+  template <typename U>
+  bool operator==(const BudgetAllocator<U> &other) const { return budget_ == other.budget(); }
+
+private:
+  MemoryBudget *budget_;
+};
+
+template <typename T>
+using BudgetVector = std::vector<T, BudgetAllocator<T>>;
+
+// charge for a buffer that is allocated elsewhere (e.g. a std::vector handed to a library function),
+// from construction to the end of the scope
+class BudgetReservation
+{
+public:
+  BudgetReservation(MemoryBudget &budget, size_t bytes) : budget_(budget), bytes_(bytes) { budget_.charge(bytes_); }
+  ~BudgetReservation() { budget_.release(bytes_); }
+
+  BudgetReservation(const BudgetReservation &) = delete;
+  BudgetReservation &operator=(const BudgetReservation &) = delete;
+
+private:
+  MemoryBudget &budget_;
+  size_t bytes_;
+};
+
+#endif
@@ -0,0 +1,292 @@
+#include "MultiRx.h"
+#include "FilterIQ.h"
+#include "FFT.h"
+#include "CorrReliability.h"
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+
+namespace
+{
+  size_t spectrum_len(const Tdoa2Config &config)
+  {
+    return next_pow2(2 * config.layout.samples_per_slice - 1);
+  }
+
+  // reference correlation from the raw xcorr, as tdoa2_ref_corr
+  int finish_ref(const PreparedIQ &a, const PreparedIQ &b, const Tdoa2Config &config, RefCorr &ref)
+  {
+    if (correlate_iq_finish(a, b, config.corr_type, config.smoothing_factor_ref, ref.corr, ref.stats, false))
+      return 1;
+    ref.reliability = corr_reliability(ref.corr);
+    ref.idx = std::max_element(ref.corr.begin(), ref.corr.end()) - ref.corr.begin();
+    return 0;
+  }
+
+  // measurement slice in the valid window of the reference peak, peak delays and merge
+  int pair_measure(const RxPrepared &rx1, const RxPrepared &rx2, const Tdoa2Config &config, double rx_distance_diff,
+                   double rx_distance, const RefCorr &ref1, const RefCorr &ref3, const LagPrior *doa_prior,
+                   Tdoa2Result &result)
+  {
+    const long n = static_cast<long>(config.layout.samples_per_slice);
+    result.reliability1 = ref1.reliability;
+    result.reliability3 = ref3.reliability;
+    double interp1, interp3;
+    if (tdoa2_peak_delay(ref1.corr, ref1.idx, ref1.idx_offset, n, config.interpol, result.delay1, interp1) ||
+        tdoa2_peak_delay(ref3.corr, ref3.idx, ref3.idx_offset, n, config.interpol, result.delay3, interp3))
+      return 1;
+    if (config.interpol > 1)
+    {
+      result.delay1 = interp1;
+      result.delay3 = interp3;
+    }
+
+    if (config.measure_template)
+    {
+      // the arrivals are filtered once per receiver
+      double interp2;
+      tdoa2_arrival_delay(rx1.arrival, rx2.arrival, config, result.delay2, interp2, result.reliability2);
+      if (config.interpol > 1)
+        result.delay2 = interp2;
+      tdoa2_combine(config, rx_distance_diff, result);
+      return 0;
+    }
+
+    // DRIFT_RESAMPLE: the measurement slice of rx2 resampled for this pair
+    PreparedIQ resampled;
+    if (config.drift_compensation == DRIFT_RESAMPLE)
+    {
+      DriftModel model;
+      drift_model(result.delay1, ref1.reliability, result.delay3, ref3.reliability, config.layout,
+                  config.max_drift_ppm, model);
+      if (tdoa2_resample_measure(rx2.iq[1], config, model, resampled))
+        return 1;
+    }
+    const PreparedIQ &a = rx1.slice[1], &b = config.drift_compensation == DRIFT_RESAMPLE ? resampled : rx2.slice[1];
+
+    const size_t ref_idx = ref1.idx_offset + ref1.idx;
+    ValidWindow valid = tdoa2_valid_window(ref_idx, n, rx_distance_diff, rx_distance, config.layout.sample_rate);
+    long half_span = config.smoothing_factor > 0 ? (config.smoothing_factor - 1) / 2 : 0;
+    LagWindow raw;
+    MeasureCorr measure;
+    if (doa_prior)
+    {
+      // the searched lags take the place of the valid area
+      auto correlate = [&a, &b](long lag_lo, long lag_hi, std::vector<double> &corr, double &peak)
+      {
+        return xcorr_window(a, b, lag_lo, lag_hi, corr, peak);
+      };
+      LagPrior lag_prior = tdoa2_lag_prior(*doa_prior, ref_idx, n, rx_distance_diff, config.layout.sample_rate);
+      ValidWindow searched;
+      if (tdoa2_measure_prior(correlate, n, valid, lag_prior, half_span, config.report, raw, searched))
+        return 1;
+      valid = searched;
+    }
+    else if (tdoa2_measure_raw(a, b, valid, half_span, config.corr_segment_len, raw))
+      return 1;
+    if (tdoa2_measure_corr(raw, n, valid, config.smoothing_factor, measure))
+      return 1;
+
+    double interp2;
+    if (tdoa2_peak_delay(measure.corr, measure.idx, valid.lo, n, config.interpol, result.delay2, interp2))
+      return 1;
+    if (config.interpol > 1)
+      result.delay2 = interp2;
+    result.reliability2 = measure.reliability;
+    tdoa2_combine(config, rx_distance_diff, result);
+    return 0;
+  }
+}
+
+int tdoa2_prepare_slice(std::span<const std::complex<float>> signal, const Tdoa2Config &config, int k, RxPrepared &rx)
+{
+  const SliceLayout &layout = config.layout;
+  const size_t n = layout.samples_per_slice;
+  if (signal.size() != layout.total())
+  {
+    std::cerr << "Error: Length of Signal is unequal " << layout.total() << std::endl;
+    return 1;
+  }
+  if (n < 2 || layout.slice_start(2) + n > layout.total() || k < 0 || k > 2)
+  {
+    std::cerr << "Error: slices do not fit into the capture!" << std::endl;
+    return 1;
+  }
+
+  // a filtered copy only lives until the abs/dphase sequence is made
+  std::vector<std::complex<float>> filtered;
+  auto slice = signal.subspan(layout.slice_start(k), n);
+  rx.iq[k] = slice;
+  if (k == 1 && config.measure_template)
+    return tdoa2_measure_arrival(slice, config, rx.arrival);
+  int bandwidth_khz = k == 1 ? config.signal_bandwidth_khz : config.ref_bandwidth_khz;
+  if (bandwidth_khz != 0)
+  {
+    if (filter_iq(slice, filtered, bandwidth_khz, config.report))
+      std::cout << "no filtering performed!" << std::endl;
+    else
+      slice = filtered;
+  }
+  return prepare_iq(slice.data(), n, config.corr_type, rx.slice[k]);
+}
+
+int tdoa2_ref_spectrum(const Tdoa2Config &config, RxPrepared &rx)
+{
+  // windowed references are correlated per pair from the slices
+  if (!tdoa2_full_ref(config))
+  {
+    rx.ref_spectrum.clear();
+    return 0;
+  }
+
+  // both real reference sequences in one complex fft
+  const size_t n = config.layout.samples_per_slice;
+  const size_t len = spectrum_len(config);
+  const PreparedIQ &s1 = rx.slice[0], &s3 = rx.slice[2];
+  if (s1.seq.size() != n || s3.seq.size() != n)
+  {
+    std::cerr << "Error: reference slices are not prepared!" << std::endl;
+    return 1;
+  }
+  rx.ref_spectrum.assign(len, 0.0);
+  for (size_t i = 0; i < n; ++i)
+    rx.ref_spectrum[i] = std::complex<double>(s1.seq[i] - s1.mean, s3.seq[i] - s3.mean);
+  get_fft_plan(len).forward(rx.ref_spectrum);
+  return 0;
+}
+
+int tdoa2_prepare_rx(std::span<const std::complex<float>> signal, const Tdoa2Config &config, RxPrepared &rx)
+{
+  for (int k = 0; k < 3; ++k)
+    if (tdoa2_prepare_slice(signal, config, k, rx))
+      return 1;
+  return tdoa2_ref_spectrum(config, rx);
+}
+
+void tdoa2_warm_up(const Tdoa2Config &config)
+{
+  if (config.corr_segment_len > 0)
+    get_fft_plan(next_pow2(2 * std::min(config.corr_segment_len, config.layout.samples_per_slice)));
+  else if (config.corr_mode == CORR_MODE_COARSE_FINE)
+    get_fft_plan(next_pow2(2 * (config.layout.samples_per_slice / CoarseFineConfig().decimation) - 1));
+  else
+    get_fft_plan(spectrum_len(config));
+}
+
+int tdoa2_pair(const RxPrepared &rx1, const RxPrepared &rx2, const Tdoa2Config &config, double rx_distance_diff,
+               double rx_distance, Tdoa2Result &result, const LagPrior *doa_prior)
+{
+  const long n = static_cast<long>(config.layout.samples_per_slice);
+  RefCorr ref1, ref3;
+  if (!tdoa2_full_ref(config))
+  {
+    if (tdoa2_ref_corr(rx1.slice[0], rx2.slice[0], config, ref1, rx1.iq[0], rx2.iq[0]) ||
+        tdoa2_ref_corr(rx1.slice[2], rx2.slice[2], config, ref3, rx1.iq[2], rx2.iq[2]))
+      return 1;
+    return pair_measure(rx1, rx2, config, rx_distance_diff, rx_distance, ref1, ref3, doa_prior, result);
+  }
+
+  const size_t len = spectrum_len(config);
+  if (rx1.ref_spectrum.size() != len || rx2.ref_spectrum.size() != len)
+  {
+    std::cerr << "Error: receivers are not prepared for this config!" << std::endl;
+    return 1;
+  }
+
+  // cross spectra of slice 1 (real part) and slice 3 (imaginary part), both hermitian, so one inverse
+  // fft yields both correlations: X[k] = (Z[k] + Z*[-k]) / 2 is slice 1, (Z[k] - Z*[-k]) / 2i slice 3
+  std::vector<std::complex<double>> z(len);
+  const std::complex<double> *za = rx1.ref_spectrum.data(), *zb = rx2.ref_spectrum.data();
+  const std::complex<double> half_i(0.0, -0.5);
+  for (size_t k = 0; k <= len / 2; ++k)
+  {
+    size_t kn = (len - k) & (len - 1);
+    std::complex<double> ak = za[k], an = std::conj(za[kn]), bk = zb[k], bn = std::conj(zb[kn]);
+    std::complex<double> c1 = 0.5 * (ak + an) * std::conj(0.5 * (bk + bn));
+    std::complex<double> c3 = half_i * (ak - an) * std::conj(half_i * (bk - bn));
+    z[k] = c1 + std::complex<double>(0.0, 1.0) * c3;
+    z[kn] = std::conj(c1) + std::complex<double>(0.0, 1.0) * std::conj(c3);
+  }
+  get_fft_plan(len).inverse(z);
+
+  ref1.corr.resize(2 * n - 1);
+  ref3.corr.resize(2 * n - 1);
+  ref1.stats.peak = ref3.stats.peak = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < static_cast<size_t>(2 * n - 1); ++i)
+  {
+    size_t k = (i + len - (n - 1)) & (len - 1);
+    ref1.corr[i] = z[k].real();
+    ref3.corr[i] = z[k].imag();
+    ref1.stats.peak = std::max(ref1.stats.peak, ref1.corr[i]);
+    ref3.stats.peak = std::max(ref3.stats.peak, ref3.corr[i]);
+  }
+  std::vector<std::complex<double>>().swap(z);
+  if (finish_ref(rx1.slice[0], rx2.slice[0], config, ref1) || finish_ref(rx1.slice[2], rx2.slice[2], config, ref3))
+    return 1;
+  return pair_measure(rx1, rx2, config, rx_distance_diff, rx_distance, ref1, ref3, doa_prior, result);
+}
+
+std::vector<TaskGraph::TaskId> tdoa2_pairs_tasks(TaskGraph &graph, const std::vector<std::span<const std::complex<float>>> &signals,
+                                                 const std::vector<TaskGraph::TaskId> &signal_ready, const Tdoa2Config &config,
+                                                 std::vector<RxPairJob> &jobs, std::vector<RxPrepared> &prepared)
+{
+  prepared.resize(signals.size());
+  std::vector<TaskGraph::TaskId> ready(signals.size(), SIZE_MAX); // reference spectrum task per receiver
+  std::vector<TaskGraph::TaskId> measure(signals.size());        // measurement slice task per receiver
+  auto add_rx = [&](size_t rx)
+  {
+    if (ready[rx] != SIZE_MAX)
+      return;
+    std::vector<TaskGraph::TaskId> deps;
+    if (!signal_ready.empty())
+      deps.push_back(signal_ready[rx]);
+    std::string name = "rx" + std::to_string(rx + 1);
+    const char *slice_names[3] = {" ref", " measure", " ref check"};
+    TaskGraph::TaskId slice_task[3];
+    for (int k = 0; k < 3; ++k)
+      slice_task[k] = graph.add(name + slice_names[k], [&signals, &prepared, config, rx, k]()
+      {
+        return tdoa2_prepare_slice(signals[rx], config, k, prepared[rx]);
+      }, deps, "slice");
+    measure[rx] = slice_task[1];
+    ready[rx] = graph.add(name + " ref fft", [&prepared, config, rx]()
+    {
+      return tdoa2_ref_spectrum(config, prepared[rx]);
+    }, {slice_task[0], slice_task[2]}, "ref fft");
+  };
+
+  std::vector<TaskGraph::TaskId> pair_tasks;
+  for (RxPairJob &job : jobs)
+  {
+    job.ok = false;
+    if (job.rx1 >= signals.size() || job.rx2 >= signals.size() || job.rx1 == job.rx2)
+    {
+      std::cerr << "Error: invalid receiver pair " << job.rx1 + 1 << " & " << job.rx2 + 1 << std::endl;
+      continue;
+    }
+    add_rx(job.rx1);
+    add_rx(job.rx2);
+    // a failed pair only clears its ok flag, the graph keeps running
+    pair_tasks.push_back(graph.add("pair " + std::to_string(job.rx1 + 1) + "&" + std::to_string(job.rx2 + 1),
+                                   [&prepared, &job, config]()
+    {
+      job.ok = tdoa2_pair(prepared[job.rx1], prepared[job.rx2], config, job.rx_distance_diff, job.rx_distance,
+                          job.result, job.has_prior ? &job.prior : nullptr) == 0;
+      return 0;
+    }, {ready[job.rx1], measure[job.rx1], ready[job.rx2], measure[job.rx2]}, "pair"));
+  }
+  return pair_tasks;
+}
+
+int tdoa2_pairs(const std::vector<std::span<const std::complex<float>>> &signals, const Tdoa2Config &config,
+                std::vector<RxPairJob> &jobs, unsigned num_threads)
+{
+  ThreadPool pool(num_threads);
+  TaskGraph graph;
+  std::vector<RxPrepared> prepared;
+  if (tdoa2_pairs_tasks(graph, signals, {}, config, jobs, prepared).size() != jobs.size())
+    return 1;
+  return graph.run(pool);
+}
@@ -0,0 +1,68 @@
+#ifndef MULTI_RX_H
+#define MULTI_RX_H
+
+#include <vector>
+#include <complex>
+#include <span>
+#include <cstddef>
+#include "Tdoa2.h"
+#include "TaskGraph.h"
+
+// tdoa2 of any number of receivers: every receiver is preprocessed once (slice filters, abs/dphase,
+// spectra of the two reference slices), a pair then costs one complex multiply + inverse fft for
+// both reference correlations and a lag window correlation of the measurement slices (with a matched
+// filter template: the difference of the arrivals, one template filter per receiver)
+
+// preprocessed capture of one receiver
+struct RxPrepared
+{
+  PreparedIQ slice[3];                            // ref, measure, ref check
+  std::vector<std::complex<double>> ref_spectrum; // fft of (slice 0 - mean) + i*(slice 2 - mean), len points
+                                                  // (empty if !tdoa2_full_ref, the pairs correlate the slices)
+  std::span<const std::complex<float>> iq[3];     // unfiltered slices, views into the capture (CORR_MODE_DAB, DRIFT_RESAMPLE)
+  Arrival arrival;                                // measure_template: arrival in the measurement slice
+                                                  // (slice[1] is not prepared then)
+};
+
+// one receiver pair: rx1, rx2 (0 based), distances as for Tdoa2::run
+struct RxPairJob
+{
+  size_t rx1;
+  size_t rx2;
+  double rx_distance_diff; // (Ref to rx1 - Ref to rx2) in meters
+  double rx_distance;      // rx1 to rx2 in meters
+  bool has_prior = false;  // measurement searched around prior instead of the whole valid area
+  LagPrior prior;          // expected TDOA in samples (doa_samples) +- tolerance
+  bool ok;                 // false if the pair failed
+  Tdoa2Result result;
+};
+
+int tdoa2_prepare_rx(std::span<const std::complex<float>> signal, const Tdoa2Config &config, RxPrepared &rx);
+
+// the two steps of tdoa2_prepare_rx: filter + abs/dphase of slice k (0..2, independent of each other),
+// then the reference spectrum from slices 0 and 2
+int tdoa2_prepare_slice(std::span<const std::complex<float>> signal, const Tdoa2Config &config, int k, RxPrepared &rx);
+int tdoa2_ref_spectrum(const Tdoa2Config &config, RxPrepared &rx);
+
+// creates the fft plans used by the pairs (e.g. before the first capture of a long running process)
+void tdoa2_warm_up(const Tdoa2Config &config);
+
+// same result as Tdoa2::run on the two captures, without console output (except reference warnings)
+// doa_prior (if not null): the measurement is only correlated around this TDOA (tdoa2_measure_prior)
+int tdoa2_pair(const RxPrepared &rx1, const RxPrepared &rx2, const Tdoa2Config &config, double rx_distance_diff,
+               double rx_distance, Tdoa2Result &result, const LagPrior *doa_prior = nullptr);
+
+// tasks of all jobs in graph: per used receiver one task per slice and one for the reference spectrum,
+// per job one pair task that depends only on its two receivers
+// signals[rx] is read when the tasks run, signal_ready[rx] (if not empty) is the task that provides it,
+// signals, jobs and prepared must outlive the graph run, returns the pair task ids (invalid jobs are left out)
+std::vector<TaskGraph::TaskId> tdoa2_pairs_tasks(TaskGraph &graph, const std::vector<std::span<const std::complex<float>>> &signals,
+                                                 const std::vector<TaskGraph::TaskId> &signal_ready, const Tdoa2Config &config,
+                                                 std::vector<RxPairJob> &jobs, std::vector<RxPrepared> &prepared);
+
+// preprocesses the receivers used by the jobs and runs the pairs as a task graph (num_threads 0: all cores)
+// returns 1 if a receiver cannot be preprocessed, failed pairs only clear their ok flag
+int tdoa2_pairs(const std::vector<std::span<const std::complex<float>>> &signals, const Tdoa2Config &config,
+                std::vector<RxPairJob> &jobs, unsigned num_threads = 0);
+
+#endif
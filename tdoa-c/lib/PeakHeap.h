@@ -0,0 +1,92 @@
+#ifndef PEAK_HEAP_H
+#define PEAK_HEAP_H
+
+#include <cstddef>
+#include <utility>
+#include <limits>
+
+// fixed size min-heap keeping the K largest (value, index) pairs seen so far
+// storage is inline, push() never allocates
+// limit (<= K) lowers the number of kept entries at run time
+template <size_t K>
+class PeakHeap
+{
+public:
+  explicit PeakHeap(size_t limit = K) : limit_(limit < K ? limit : K) {}
+
+  struct Entry
+  {
+    double value;
+    size_t index;
+  };
+
+  size_t size() const { return size_; }
+  const Entry &operator[](size_t i) const { return heap_[i]; } // heap order, not sorted
+
+  // smallest kept value, only valid if full() (+inf for limit 0: nothing gets in)
+  double threshold() const { return limit_ == 0 ? std::numeric_limits<double>::infinity() : heap_[0].value; }
+  bool full() const { return size_ == limit_; }
+
+  void clear() { size_ = 0; }
+
+  void push(double value, size_t index)
+  {
+    if (limit_ == 0)
+      return;
+    if (size_ < limit_)
+    {
+      size_t i = size_++;
+      heap_[i] = {value, index};
+      while (i > 0 && less(heap_[i], heap_[(i - 1) / 2]))
+      {
+        std::swap(heap_[i], heap_[(i - 1) / 2]);
+        i = (i - 1) / 2;
+      }
+    }
+    else if (value > heap_[0].value)
+    {
+      heap_[0] = {value, index};
+      sift_down(0, size_);
+    }
+  }
+
+  // sorts the kept entries in place, largest first (the heap is consumed)
+  size_t sort_descending()
+  {
+    for (size_t end = size_; end > 1; --end)
+    {
+      std::swap(heap_[0], heap_[end - 1]);
+      sift_down(0, end - 1);
+    }
+    return size_;
+  }
+
+private:
+  static bool less(const Entry &a, const Entry &b)
+  {
+    // equal values: the later index is dropped first, like max() keeping the first maximum
+    return a.value < b.value || (a.value == b.value && a.index > b.index);
+  }
+
+  void sift_down(size_t i, size_t n)
+  {
+    for (;;)
+    {
+      size_t l = 2 * i + 1, r = l + 1, m = i;
+      if (l < n && less(heap_[l], heap_[m]))
+        m = l;
+      if (r < n && less(heap_[r], heap_[m]))
+        m = r;
+      if (m == i)
+        return;
+      std::swap(heap_[i], heap_[m]);
+      i = m;
+    }
+  }
+
+  Entry heap_[K];
+  size_t size_ = 0;
+  size_t limit_;
+};
+
+#endif
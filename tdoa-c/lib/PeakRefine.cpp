@@ -0,0 +1,275 @@
+#include "PeakRefine.h"
+#include "FFT.h"
+#include <iostream>
+#include <cmath>
+#include <complex>
+#include <algorithm>
+
+namespace
+{
+  const int SINC_HALF_WIDTH = 8; // samples on each side used for the band-limited fit
+  const size_t UPSAMPLE_LEN = 32; // neighbourhood length for the FFT upsampling
+
+  // 3 point parabola through (-1, ym), (0, y0), (1, yp)
+  // the variance follows from the partial derivatives of the vertex w.r.t. the three samples
+  bool fit_parabola(double ym, double y0, double yp, double sigm, double sig0, double sigp,
+                    double &offset, double &amplitude, double &variance)
+  {
+    double num = ym - yp;
+    double den = ym - 2.0 * y0 + yp;
+    if (!(den < 0.0)) // not a maximum (flat or curved the wrong way)
+      return false;
+
+    offset = 0.5 * num / den;
+    if (std::fabs(offset) > 1.0)
+      return false;
+    amplitude = y0 - 0.25 * num * offset;
+
+    double dm = 0.5 * (den - num) / (den * den);
+    double d0 = num / (den * den);
+    double dp = 0.5 * (-den - num) / (den * den);
+    variance = dm * dm * sigm * sigm + d0 * d0 * sig0 * sig0 + dp * dp * sigp * sigp;
+    return true;
+  }
+
+  // correlation noise = rms of the sidelobe floor in two fixed rings left and right of the peak
+  double local_noise(const double *y, size_t n, size_t idx)
+  {
+    const size_t ring_lo = 4 * SINC_HALF_WIDTH, ring_hi = 12 * SINC_HALF_WIDTH;
+    double sum = 0.0;
+    size_t count = 0;
+    for (size_t k = ring_lo; k < ring_hi; ++k)
+    {
+      if (idx >= k)
+      {
+        sum += y[idx - k] * y[idx - k];
+        ++count;
+      }
+      if (idx + k < n)
+      {
+        sum += y[idx + k] * y[idx + k];
+        ++count;
+      }
+    }
+    return count ? std::sqrt(sum / static_cast<double>(count)) : 0.0;
+  }
+
+  double lanczos(double x)
+  {
+    const double a = SINC_HALF_WIDTH;
+    if (x == 0.0)
+      return 1.0;
+    if (std::fabs(x) >= a)
+      return 0.0;
+    double px = M_PI * x;
+    return a * std::sin(px) * std::sin(px / a) / (px * px);
+  }
+
+  double lanczos_derivative(double x)
+  {
+    const double e = 1e-4;
+    return (lanczos(x + e) - lanczos(x - e)) / (2.0 * e);
+  }
+
+  // band-limited reconstruction of y around idx at offset t
+  double sinc_value(const double *y, long lo, long hi, long idx, double t)
+  {
+    double v = 0.0;
+    for (long k = lo; k <= hi; ++k)
+      v += y[k] * lanczos(t - static_cast<double>(k - idx));
+    return v;
+  }
+
+  // variance of the band-limited peak position at offset t
+  // implicit derivative of f'(t) = 0: dt/dy_k = -L'(t - k) / f''(t)
+  double sinc_variance(const double *y, size_t n, size_t idx, double t, double sigma)
+  {
+    long i = static_cast<long>(idx);
+    long lo = std::max(0L, i - SINC_HALF_WIDTH);
+    long hi = std::min(static_cast<long>(n) - 1, i + SINC_HALF_WIDTH);
+
+    const double e = 1e-3;
+    double f2 = (sinc_value(y, lo, hi, i, t + e) - 2.0 * sinc_value(y, lo, hi, i, t) + sinc_value(y, lo, hi, i, t - e)) / (e * e);
+    if (!(f2 < 0.0))
+      return 1.0 / 12.0;
+
+    double sum = 0.0;
+    for (long k = lo; k <= hi; ++k)
+    {
+      double dt = lanczos_derivative(t - static_cast<double>(k - i)) / f2;
+      sum += dt * dt;
+    }
+    return sigma * sigma * sum;
+  }
+
+  int refine_sinc(const double *y, size_t n, size_t idx, double sigma, PeakEstimate &estimate)
+  {
+    long i = static_cast<long>(idx);
+    long lo = std::max(0L, i - SINC_HALF_WIDTH);
+    long hi = std::min(static_cast<long>(n) - 1, i + SINC_HALF_WIDTH);
+
+    // golden section search on [-1, 1], the peak of the reconstruction lies within one sample
+    const double g = 0.5 * (std::sqrt(5.0) - 1.0);
+    double a = -1.0, b = 1.0;
+    double c = b - g * (b - a), d = a + g * (b - a);
+    double fc = sinc_value(y, lo, hi, i, c), fd = sinc_value(y, lo, hi, i, d);
+    for (int it = 0; it < 48; ++it)
+    {
+      if (fc > fd)
+      {
+        b = d;
+        d = c;
+        fd = fc;
+        c = b - g * (b - a);
+        fc = sinc_value(y, lo, hi, i, c);
+      }
+      else
+      {
+        a = c;
+        c = d;
+        fc = fd;
+        d = a + g * (b - a);
+        fd = sinc_value(y, lo, hi, i, d);
+      }
+    }
+    double t = 0.5 * (a + b);
+
+    estimate.offset = t;
+    estimate.amplitude = sinc_value(y, lo, hi, i, t);
+    estimate.variance = sinc_variance(y, n, idx, t, sigma);
+    return 0;
+  }
+
+  int refine_fft_upsample(const double *y, size_t n, size_t idx, double sigma, int upsample, PeakEstimate &estimate)
+  {
+    size_t m = std::min(UPSAMPLE_LEN, n);
+    size_t p = 1;
+    while (p * 2 <= m)
+      p *= 2;
+    m = p;
+    size_t u = next_pow2(static_cast<size_t>(std::max(upsample, 2)));
+    size_t mu = m * u;
+
+    size_t start = (idx >= m / 2) ? idx - m / 2 : 0;
+    start = std::min(start, n - m);
+
+    const FFTPlan &plan_m = get_fft_plan(m);
+    const FFTPlan &plan_mu = get_fft_plan(mu);
+
+    std::vector<std::complex<double>> spec(m);
+    for (size_t k = 0; k < m; ++k)
+      spec[k] = y[start + k];
+    plan_m.forward(spec);
+
+    // zero padding in the middle of the spectrum, the nyquist bin is split between both halves
+    std::vector<std::complex<double>> up(mu, 0.0);
+    for (size_t k = 0; k < m / 2; ++k)
+      up[k] = spec[k];
+    for (size_t k = m / 2 + 1; k < m; ++k)
+      up[mu - m + k] = spec[k];
+    up[m / 2] = 0.5 * spec[m / 2];
+    up[mu - m / 2] = 0.5 * spec[m / 2];
+    plan_mu.inverse(up);
+
+    // search the upsampled maximum within one native sample of idx
+    long centre = static_cast<long>((idx - start) * u);
+    long j_lo = std::max(1L, centre - static_cast<long>(u));
+    long j_hi = std::min(static_cast<long>(mu) - 2, centre + static_cast<long>(u));
+    long best = centre;
+    for (long j = j_lo; j <= j_hi; ++j)
+      if (up[j].real() > up[best].real())
+        best = j;
+
+    // the ifft scaling by 1/(m*u) instead of 1/m is undone by 'scale'
+    // a parabola on the fine grid removes the remaining 1/u quantisation
+    double scale = static_cast<double>(u);
+    // without a fit (no maximum or vertex beyond the neighbours) the grid point is the estimate
+    double off = 0.0, amp = up[best].real() * scale, fit_off, fit_amp, var;
+    if (fit_parabola(up[best - 1].real() * scale, amp, up[best + 1].real() * scale, 0.0, 0.0, 0.0, fit_off, fit_amp, var))
+    {
+      off = fit_off;
+      amp = fit_amp;
+    }
+
+    double pos = static_cast<double>(start) + (static_cast<double>(best) + off) / scale;
+    estimate.offset = pos - static_cast<double>(idx);
+    estimate.amplitude = amp;
+    // neighbouring upsampled values are fully correlated, so the variance is taken from
+    // the band-limited model of the native samples
+    estimate.variance = sinc_variance(y, n, idx, estimate.offset, sigma);
+    return 0;
+  }
+}
+
+int refine_peak(const double *corr, size_t n, size_t idx, PeakFit fit, PeakEstimate &estimate,
+                double noise_sigma, int upsample)
+{
+  if (idx >= n)
+  {
+    std::cerr << "Error: peak index outside of correlation!" << std::endl;
+    return 1;
+  }
+
+  // integer peak, uniform quantisation error
+  estimate.position = static_cast<double>(idx);
+  estimate.offset = 0.0;
+  estimate.amplitude = corr[idx];
+  estimate.variance = 1.0 / 12.0;
+
+  if (fit == PEAK_FIT_NONE || idx == 0 || idx + 1 >= n)
+    return 0;
+
+  double sigma = (noise_sigma > 0.0) ? noise_sigma : local_noise(corr, n, idx);
+  double ym = corr[idx - 1], y0 = corr[idx], yp = corr[idx + 1];
+  double off, amp, var;
+
+  switch (fit)
+  {
+  case PEAK_FIT_PARABOLIC:
+    if (fit_parabola(ym, y0, yp, sigma, sigma, sigma, off, amp, var))
+    {
+      estimate.offset = off;
+      estimate.amplitude = amp;
+      estimate.variance = var;
+    }
+    break;
+
+  case PEAK_FIT_GAUSSIAN:
+    if (ym > 0.0 && y0 > 0.0 && yp > 0.0 &&
+        fit_parabola(std::log(ym), std::log(y0), std::log(yp), sigma / ym, sigma / y0, sigma / yp, off, amp, var))
+    {
+      estimate.offset = off;
+      estimate.amplitude = std::exp(amp);
+      estimate.variance = var;
+    }
+    else if (fit_parabola(ym, y0, yp, sigma, sigma, sigma, off, amp, var))
+    {
+      // log undefined for non positive values, fall back to the parabola
+      estimate.offset = off;
+      estimate.amplitude = amp;
+      estimate.variance = var;
+    }
+    break;
+
+  case PEAK_FIT_SINC:
+    refine_sinc(corr, n, idx, sigma, estimate);
+    break;
+
+  case PEAK_FIT_FFT_UPSAMPLE:
+    if (n >= 4)
+      refine_fft_upsample(corr, n, idx, sigma, upsample, estimate);
+    break;
+
+  default:
+    break;
+  }
+
+  estimate.position = static_cast<double>(idx) + estimate.offset;
+  return 0;
+}
+
+int refine_peak(const std::vector<double> &corr, size_t idx, PeakFit fit, PeakEstimate &estimate,
+                double noise_sigma, int upsample)
+{
+  return refine_peak(corr.data(), corr.size(), idx, fit, estimate, noise_sigma, upsample);
+}
@@ -0,0 +1,34 @@
+#ifndef PEAK_REFINE_H
+#define PEAK_REFINE_H
+
+#include <vector>
+#include <cstddef>
+
+// sub-sample peak interpolation on the correlation itself (replaces interp() + re-correlation in tdoa2.m)
+enum PeakFit
+{
+  PEAK_FIT_NONE,        // integer peak only
+  PEAK_FIT_PARABOLIC,   // 3 point parabola
+  PEAK_FIT_GAUSSIAN,    // 3 point parabola on log values
+  PEAK_FIT_SINC,        // band-limited (windowed sinc) reconstruction around the peak
+  PEAK_FIT_FFT_UPSAMPLE // zero padded FFT upsampling of the peak neighbourhood
+};
+
+struct PeakEstimate
+{
+  double position;  // fractional index into the correlation
+  double offset;    // position - idx, in [-1, 1]
+  double amplitude; // interpolated peak value
+  double variance;  // variance of position in samples^2
+};
+
+// corr: correlation (or lag window of it) with n values, idx: index of the integer maximum
+// noise_sigma: std. deviation of the correlation noise, <= 0: rms of the sidelobes next to the peak
+// upsample: upsampling factor for PEAK_FIT_FFT_UPSAMPLE (e.g. the old interpol factor)
+// the cost only depends on the neighbourhood size, not on n
+int refine_peak(const double *corr, size_t n, size_t idx, PeakFit fit, PeakEstimate &estimate,
+                double noise_sigma = 0.0, int upsample = 8);
+int refine_peak(const std::vector<double> &corr, size_t idx, PeakFit fit, PeakEstimate &estimate,
+                double noise_sigma = 0.0, int upsample = 8);
+
+#endif
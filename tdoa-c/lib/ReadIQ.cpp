@@ -1,23 +1,30 @@
 #include <iostream>
 #include <fstream>
 #include "ReadIQ.h"
+#include "Trace.h"
 
-int ReadIQ(const std::string &filename, std::vector<std::complex<float>> &iqSignal)
+int ReadIQ(const std::string &filename, std::vector<std::complex<float>> &iqSignal, bool report)
 {
-  std::cout << "read_file_iq" << std::endl;
-  std::cout << "IQ read from data file = " << filename << std::endl;
-
-  // Membuka file biner untuk membaca data
-  std::ifstream file(filename, std::ios::binary);
-  if (!file.is_open())
+  if (report)
   {
-    std::cerr << "Error: File tidak dapat dibuka!" << std::endl;
-    return 1;
+    std::cout << "read_file_iq" << std::endl;
+    std::cout << "IQ read from data file = " << filename << std::endl;
   }
 
-  // Membaca seluruh isi file
-  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-  file.close();
+  std::vector<uint8_t> data;
+  {
+    TraceSpan span("read");
+    // Membuka file biner untuk membaca data
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+      std::cerr << "Error: File tidak dapat dibuka!" << std::endl;
+      return 1;
+    }
+
+    // Membaca seluruh isi file
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
 
   // Memastikan ukuran array sesuai dengan pasangan I dan Q
   if (data.size() % 2 != 0)
@@ -27,7 +34,9 @@ int ReadIQ(const std::string &filename, std::vector<std::complex<float>> &iqSign
   }
 
   // Inisialisasi vektor untuk menyimpan sinyal kompleks IQ
+  TraceSpan span("convert");
   size_t num_samples = data.size() / 2;
+  iqSignal.reserve(iqSignal.size() + num_samples);
 
   // Parsing data menjadi in-phase (I) dan quadrature (Q)
   for (size_t i = 0; i < num_samples; ++i)
@@ -37,6 +46,7 @@ int ReadIQ(const std::string &filename, std::vector<std::complex<float>> &iqSign
     iqSignal.emplace_back(inphase, quadrature); // Menggabungkan I dan Q menjadi kompleks
   }
 
-  std::cout << "successfully read " << num_samples << " samples" << std::endl;
+  if (report)
+    std::cout << "successfully read " << num_samples << " samples" << std::endl;
   return 0;
 }
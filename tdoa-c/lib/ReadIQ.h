@@ -5,6 +5,7 @@
 #include <string>
 #include <complex>
 
-int ReadIQ(const std::string &filename, std::vector<std::complex<float>> &iqSignal);
+// report = false reads without the progress lines
+int ReadIQ(const std::string &filename, std::vector<std::complex<float>> &iqSignal, bool report = true);
 
 #endif
\ No newline at end of file
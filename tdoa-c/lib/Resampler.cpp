@@ -0,0 +1,95 @@
+#include "Resampler.h"
+#include <iostream>
+#include <cmath>
+
+FarrowResampler::FarrowResampler(double ratio, double start) : ratio_(ratio)
+{
+  reset(start);
+}
+
+void FarrowResampler::reset(double start)
+{
+  // zero history, the first input sample sits at buffer index HISTORY
+  re_.assign(HISTORY, 0.0f);
+  im_.assign(HISTORY, 0.0f);
+  pos_ = static_cast<double>(HISTORY) + start;
+}
+
+size_t FarrowResampler::process(const std::complex<float> *in, size_t n, std::vector<std::complex<float>> &out)
+{
+  re_.resize(HISTORY + n);
+  im_.resize(HISTORY + n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    re_[HISTORY + i] = in[i].real();
+    im_[HISTORY + i] = in[i].imag();
+  }
+
+  const size_t len = re_.size();
+  const float *re = re_.data();
+  const float *im = im_.data();
+  size_t produced = 0;
+
+  // an output at position k + mu needs the input samples k-1 .. k+2
+  if (pos_ + 2.0 < static_cast<double>(len))
+  {
+    size_t count = static_cast<size_t>(std::ceil((static_cast<double>(len) - 2.0 - pos_) / ratio_));
+    // guard against rounding at the block end
+    while (count > 0 && static_cast<size_t>(pos_ + (count - 1) * ratio_) + 2 >= len)
+      --count;
+
+    size_t first = out.size();
+    out.resize(first + count);
+    std::complex<float> *y = out.data() + first;
+    for (size_t j = 0; j < count; ++j)
+    {
+      // position from the block start instead of accumulating, no drift over long blocks
+      double t = pos_ + static_cast<double>(j) * ratio_;
+      size_t k = static_cast<size_t>(t);
+      float mu = static_cast<float>(t - static_cast<double>(k));
+
+      // farrow coefficients of the cubic through x[k-1] .. x[k+2], y = ((c3*mu + c2)*mu + c1)*mu + c0
+      float xm = re[k - 1], x0 = re[k], x1 = re[k + 1], x2 = re[k + 2];
+      float c1 = -xm * (1.0f / 3.0f) - 0.5f * x0 + x1 - x2 * (1.0f / 6.0f);
+      float c2 = 0.5f * (xm + x1) - x0;
+      float c3 = (x2 - xm) * (1.0f / 6.0f) + 0.5f * (x0 - x1);
+      float yr = ((c3 * mu + c2) * mu + c1) * mu + x0;
+
+      xm = im[k - 1], x0 = im[k], x1 = im[k + 1], x2 = im[k + 2];
+      c1 = -xm * (1.0f / 3.0f) - 0.5f * x0 + x1 - x2 * (1.0f / 6.0f);
+      c2 = 0.5f * (xm + x1) - x0;
+      c3 = (x2 - xm) * (1.0f / 6.0f) + 0.5f * (x0 - x1);
+      float yi = ((c3 * mu + c2) * mu + c1) * mu + x0;
+
+      y[j] = std::complex<float>(yr, yi);
+    }
+    pos_ += static_cast<double>(count) * ratio_;
+    produced = count;
+  }
+
+  // keep the last samples as history of the next block
+  for (size_t i = 0; i < HISTORY; ++i)
+  {
+    re_[i] = re_[len - HISTORY + i];
+    im_[i] = im_[len - HISTORY + i];
+  }
+  re_.resize(HISTORY);
+  im_.resize(HISTORY);
+  pos_ -= static_cast<double>(len - HISTORY);
+  return produced;
+}
+
+int resample_iq(const std::vector<std::complex<float>> &in, double ratio, double start,
+                std::vector<std::complex<float>> &out)
+{
+  if (ratio <= 0.0 || start < 0.0)
+  {
+    std::cerr << "Error: invalid resampling ratio or start!" << std::endl;
+    return 1;
+  }
+  FarrowResampler resampler(ratio, start);
+  out.clear();
+  out.reserve(static_cast<size_t>(static_cast<double>(in.size()) / ratio) + 1);
+  resampler.process(in.data(), in.size(), out);
+  return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <vector>
+#include <complex>
+#include <cstddef>
+#include "ClockDrift.h"
+
+// drift_compensation = resample resamples the measurement slice of the second receiver of a pair with
+// 1 / drift_ratio (tdoa2_resample_measure), the other slices are correlated as captured
+
+// streaming fractional resampler, cubic Lagrange interpolation in Farrow form
+// output sample k is taken at input position start + k * ratio, so ratio = 1 + rate offset
+// corrects a receiver whose sample clock runs fast (ratio > 1) or slow (ratio < 1)
+// blocks of any size can be pushed, the output does not depend on the block boundaries
+class FarrowResampler
+{
+public:
+  explicit FarrowResampler(double ratio = 1.0, double start = 0.0);
+
+  // start >= 0: input position of the first output sample
+  void reset(double start = 0.0);
+  void set_ratio(double ratio) { ratio_ = ratio; }
+  double ratio() const { return ratio_; }
+
+  // consumes n input samples and appends the outputs that are complete (latency 2 samples)
+  // returns the number of appended samples
+  size_t process(const std::complex<float> *in, size_t n, std::vector<std::complex<float>> &out);
+
+private:
+  static const size_t HISTORY = 3;
+
+  double ratio_;
+  double pos_; // position of the next output in the work buffer
+  // planar work buffer: HISTORY samples of the previous block followed by the current block
+  std::vector<float> re_, im_;
+};
+
+// ratio that removes the drift of the first signal relative to the second, so the delay
+// of the resampled signal stays at model.offset - model.slope * model.t_ref over the capture
+inline double drift_ratio(const DriftModel &model)
+{
+  return 1.0 + model.slope;
+}
+
+// one shot resampling of a whole slice
+int resample_iq(const std::vector<std::complex<float>> &in, double ratio, double start,
+                std::vector<std::complex<float>> &out);
+
+#endif
@@ -0,0 +1,293 @@
+#include "ResultCache.h"
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <functional>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace
+{
+  // part of every key, a new version invalidates all entries (e.g. after a change of tdoa2's results)
+  const uint64_t CACHE_VERSION = 1;
+
+  const uint64_t P1 = 0x9E3779B185EBCA87ULL;
+  const uint64_t P2 = 0xC2B2AE3D27D4EB4FULL;
+  const uint64_t P3 = 0x165667B19E3779F9ULL;
+  const uint64_t P4 = 0x85EBCA77C2B2AE63ULL;
+  const uint64_t P5 = 0x27D4EB2F165667C5ULL;
+
+  uint64_t rotl(uint64_t x, int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  uint64_t hash_round(uint64_t acc, uint64_t input)
+  {
+    return rotl(acc + input * P2, 31) * P1;
+  }
+
+  uint64_t load64(const unsigned char *p)
+  {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+  }
+
+  const size_t PAIR_VALUES = 12; // ok + the fields of Tdoa2Result
+  const size_t FIX_VALUES = 3;   // located, lat, long
+}
+
+Hash64::Hash64(uint64_t seed) : lane_{seed + P1 + P2, seed + P2, seed, seed - P1}, tail_len_(0), total_(0)
+{
+}
+
+void Hash64::add(const void *data, size_t len)
+{
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  total_ += len;
+  if (tail_len_ + len < sizeof(tail_))
+  {
+    std::memcpy(tail_ + tail_len_, p, len);
+    tail_len_ += len;
+    return;
+  }
+  if (tail_len_)
+  {
+    size_t fill = sizeof(tail_) - tail_len_;
+    std::memcpy(tail_ + tail_len_, p, fill);
+    for (int l = 0; l < 4; ++l)
+      lane_[l] = hash_round(lane_[l], load64(tail_ + 8 * l));
+    p += fill;
+    len -= fill;
+    tail_len_ = 0;
+  }
+  // full stripes straight from the input, the lanes are independent
+  uint64_t v0 = lane_[0], v1 = lane_[1], v2 = lane_[2], v3 = lane_[3];
+  for (; len >= 32; p += 32, len -= 32)
+  {
+    v0 = hash_round(v0, load64(p));
+    v1 = hash_round(v1, load64(p + 8));
+    v2 = hash_round(v2, load64(p + 16));
+    v3 = hash_round(v3, load64(p + 24));
+  }
+  lane_[0] = v0;
+  lane_[1] = v1;
+  lane_[2] = v2;
+  lane_[3] = v3;
+  std::memcpy(tail_, p, len);
+  tail_len_ = len;
+}
+
+uint64_t Hash64::value() const
+{
+  uint64_t h;
+  if (total_ >= 32)
+  {
+    h = rotl(lane_[0], 1) + rotl(lane_[1], 7) + rotl(lane_[2], 12) + rotl(lane_[3], 18);
+    for (int l = 0; l < 4; ++l)
+      h = (h ^ hash_round(0, lane_[l])) * P1 + P4;
+  }
+  else
+    h = lane_[2] + P5; // the seed
+  h += total_;
+
+  size_t i = 0;
+  for (; i + 8 <= tail_len_; i += 8)
+    h = rotl(h ^ hash_round(0, load64(tail_ + i)), 27) * P1 + P4;
+  for (; i < tail_len_; ++i)
+    h = rotl(h ^ (tail_[i] * P5), 11) * P1;
+
+  h ^= h >> 33;
+  h *= P2;
+  h ^= h >> 29;
+  h *= P3;
+  h ^= h >> 32;
+  return h;
+}
+
+int hash_file(const std::string &filename, uint64_t &hash)
+{
+  TraceSpan span("hash");
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open())
+  {
+    std::cerr << "Error: file " << filename << " cannot be opened!" << std::endl;
+    return 1;
+  }
+  Hash64 h(CACHE_VERSION);
+  std::vector<char> buffer(1 << 20);
+  while (file)
+  {
+    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    h.add(buffer.data(), static_cast<size_t>(file.gcount()));
+  }
+  if (file.bad())
+  {
+    std::cerr << "Error: file " << filename << " cannot be read!" << std::endl;
+    return 1;
+  }
+  hash = h.value();
+  return 0;
+}
+
+uint64_t cache_pair_key(uint64_t file1, uint64_t file2, const Tdoa2Config &config, double rx_distance_diff, double rx_distance,
+                        const LagPrior *prior)
+{
+  // every Tdoa2Config field except report
+  Hash64 h(CACHE_VERSION);
+  h.add(file1);
+  h.add(file2);
+  h.add(static_cast<uint64_t>(config.smoothing_factor));
+  h.add(static_cast<uint64_t>(config.corr_type));
+  h.add(static_cast<uint64_t>(config.signal_bandwidth_khz));
+  h.add(static_cast<uint64_t>(config.ref_bandwidth_khz));
+  h.add(static_cast<uint64_t>(config.smoothing_factor_ref));
+  h.add(static_cast<uint64_t>(config.interpol));
+  h.add(static_cast<uint64_t>(config.corr_segment_len));
+  h.add(static_cast<uint64_t>(config.corr_mode));
+  h.add(static_cast<uint64_t>(config.layout.samples_per_freq));
+  h.add(static_cast<uint64_t>(config.layout.samples_per_slice));
+  h.add(static_cast<uint64_t>(config.layout.guard_interval));
+  h.add(config.layout.sample_rate);
+  h.add(static_cast<uint64_t>(config.drift_compensation));
+  h.add(config.max_drift_ppm);
+  h.add(static_cast<uint64_t>(config.measure_template != nullptr));
+  if (config.measure_template)
+  {
+    const std::vector<std::complex<double>> &waveform = config.measure_template->waveform();
+    h.add(waveform.data(), waveform.size() * sizeof(waveform[0]));
+  }
+  h.add(rx_distance_diff);
+  h.add(rx_distance);
+  h.add(static_cast<uint64_t>(prior != nullptr));
+  if (prior)
+  {
+    h.add(prior->center);
+    h.add(prior->tolerance);
+  }
+  return h.value();
+}
+
+uint64_t cache_fix_key(const std::vector<uint64_t> &pair_keys, const std::vector<std::pair<size_t, size_t>> &pairs,
+                       const std::vector<LatLong> &rx, int heatmap_resolution)
+{
+  Hash64 h(CACHE_VERSION);
+  for (size_t i = 0; i < pair_keys.size() && i < pairs.size(); ++i)
+  {
+    h.add(pair_keys[i]);
+    h.add(static_cast<uint64_t>(pairs[i].first));
+    h.add(static_cast<uint64_t>(pairs[i].second));
+  }
+  for (const LatLong &p : rx)
+  {
+    h.add(p.lat);
+    h.add(p.lon);
+  }
+  h.add(static_cast<uint64_t>(heatmap_resolution));
+  return h.value();
+}
+
+int ResultCache::open(const std::string &dir)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec || !std::filesystem::is_directory(dir))
+  {
+    std::cerr << "Error: cache directory " << dir << " cannot be created: " << ec.message() << std::endl;
+    return 1;
+  }
+  dir_ = dir.back() == '/' ? dir : dir + "/";
+  return 0;
+}
+
+std::string ResultCache::path(char kind, uint64_t key) const
+{
+  std::ostringstream name;
+  name << dir_ << kind << std::hex << std::setw(16) << std::setfill('0') << key;
+  return name.str();
+}
+
+// entry: "tdoa-cache <version> <kind> <n>" and n values in hexfloat (exact round trip)
+bool ResultCache::load(char kind, uint64_t key, std::vector<double> &values)
+{
+  std::ifstream file(path(kind, key));
+  std::string magic, value;
+  uint64_t version = 0;
+  char entry_kind = 0;
+  size_t n = 0;
+  bool ok = file.is_open() && (file >> magic >> version >> entry_kind >> n) && magic == "tdoa-cache" &&
+            version == CACHE_VERSION && entry_kind == kind && n == values.size();
+  for (size_t i = 0; ok && i < n; ++i)
+  {
+    char *end;
+    ok = static_cast<bool>(file >> value);
+    values[i] = ok ? std::strtod(value.c_str(), &end) : 0.0;
+    ok = ok && *end == '\0';
+  }
+  ok ? ++hits_ : ++misses_;
+  return ok;
+}
+
+void ResultCache::store(char kind, uint64_t key, const std::vector<double> &values)
+{
+  std::string target = path(kind, key);
+  std::ostringstream temp;
+  temp << target << ".tmp" << getpid() << "_" << std::hash<std::thread::id>()(std::this_thread::get_id()) << "_" << temp_counter_++;
+  {
+    std::ofstream file(temp.str());
+    file << "tdoa-cache " << CACHE_VERSION << " " << kind << " " << values.size() << std::endl << std::hexfloat;
+    for (double v : values)
+      file << v << " ";
+    file << std::endl;
+    if (!file)
+    {
+      std::cerr << "Error: cache entry " << temp.str() << " cannot be written!" << std::endl;
+      return;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp.str(), target, ec);
+  if (ec)
+  {
+    std::cerr << "Error: cache entry " << target << " cannot be written: " << ec.message() << std::endl;
+    std::filesystem::remove(temp.str(), ec);
+  }
+}
+
+bool ResultCache::load_pair(uint64_t key, bool &ok, Tdoa2Result &result)
+{
+  std::vector<double> v(PAIR_VALUES);
+  if (!load('p', key, v))
+    return false;
+  ok = v[0] != 0.0;
+  result = {v[1], v[2], v[3], v[4], v[5], v[6], v[7], v[8], v[9], v[10], v[11]};
+  return true;
+}
+
+void ResultCache::store_pair(uint64_t key, bool ok, const Tdoa2Result &result)
+{
+  const Tdoa2Result &r = result;
+  store('p', key, {ok ? 1.0 : 0.0, r.doa_meters, r.doa_samples, r.reliability, r.delay1, r.delay2, r.delay3,
+                   r.reliability1, r.reliability2, r.reliability3, r.ref_delay, r.drift_ppm});
+}
+
+bool ResultCache::load_fix(uint64_t key, bool &located, LatLong &peak)
+{
+  std::vector<double> v(FIX_VALUES);
+  if (!load('f', key, v))
+    return false;
+  located = v[0] != 0.0;
+  peak = {v[1], v[2]};
+  return true;
+}
+
+void ResultCache::store_fix(uint64_t key, bool located, const LatLong &peak)
+{
+  store('f', key, {located ? 1.0 : 0.0, peak.lat, peak.lon});
+}
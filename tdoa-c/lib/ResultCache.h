@@ -0,0 +1,77 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "Geo.h"
+#include "Tdoa2.h"
+
+// persistent, content addressed cache of pair results and fixes
+// a pair is keyed by the contents of its two receiver files and the parameters of tdoa2, a fix by the
+// keys of its pairs, the receiver positions and the heatmap resolution, so a change of a downstream
+// parameter (e.g. heatmap_resolution) still finds the pairs
+// one small file per entry in the cache directory, written to a temporary file and renamed, so several
+// processes may share a directory and a crash never leaves a partial entry
+
+// 64 bit hash of a byte stream (xxhash64 style: 4 lanes of 8 bytes, then the tail)
+class Hash64
+{
+public:
+  explicit Hash64(uint64_t seed = 0);
+
+  void add(const void *data, size_t len);
+  void add(uint64_t v) { add(&v, sizeof(v)); }
+  void add(double v) { add(&v, sizeof(v)); }
+  uint64_t value() const;
+
+private:
+  uint64_t lane_[4];
+  unsigned char tail_[32];
+  size_t tail_len_;
+  uint64_t total_;
+};
+
+// hash of the file contents, returns 1 if the file cannot be read
+int hash_file(const std::string &filename, uint64_t &hash);
+
+// key of a pair: file hashes of rx1 and rx2, all fields of config that change the result, distances and
+// the TDOA prior of the pair (null if none)
+uint64_t cache_pair_key(uint64_t file1, uint64_t file2, const Tdoa2Config &config, double rx_distance_diff, double rx_distance,
+                        const LagPrior *prior);
+
+// key of a fix: pair keys with their receivers, receiver positions, heatmap resolution
+uint64_t cache_fix_key(const std::vector<uint64_t> &pair_keys, const std::vector<std::pair<size_t, size_t>> &pairs,
+                       const std::vector<LatLong> &rx, int heatmap_resolution);
+
+class ResultCache
+{
+public:
+  // creates the directory if needed, returns 1 if it cannot be used
+  int open(const std::string &dir);
+  bool is_open() const { return !dir_.empty(); }
+
+  // load: false on a miss (or an unreadable entry), store: errors only lose the entry
+  bool load_pair(uint64_t key, bool &ok, Tdoa2Result &result);
+  void store_pair(uint64_t key, bool ok, const Tdoa2Result &result);
+  bool load_fix(uint64_t key, bool &located, LatLong &peak);
+  void store_fix(uint64_t key, bool located, const LatLong &peak);
+
+  size_t hits() const { return hits_; }
+  size_t misses() const { return misses_; }
+
+private:
+  std::string path(char kind, uint64_t key) const;
+  bool load(char kind, uint64_t key, std::vector<double> &values);
+  void store(char kind, uint64_t key, const std::vector<double> &values);
+
+  std::string dir_;
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> misses_{0};
+  std::atomic<size_t> temp_counter_{0};
+};
+
+#endif
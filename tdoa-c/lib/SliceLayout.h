@@ -0,0 +1,33 @@
+#ifndef SLICE_LAYOUT_H
+#define SLICE_LAYOUT_H
+
+#include <cstddef>
+
+// slicing of one capture as in tdoa2.m
+// 1111111111111111111111111xxxxxxxxxxxxx2222222222222222222222222xxx3333..
+// |-num_samples_per_slice-|
+// |-num_samples_per_freq+guard_interval-|-num_samples_per_slice-|
+// slice 0 and 2: reference transmitter, slice 1: measurement
+struct SliceLayout
+{
+  size_t samples_per_freq = 1200000;
+  size_t samples_per_slice = 1000000;
+  size_t guard_interval = 200000; // time to switch to a new frequency, fixed, empirically determined
+  double sample_rate = 2e6;       // Hz
+
+  size_t total() const { return 3 * samples_per_freq; }
+
+  // first sample of slice 0, 1, 2 (tdoa2.m starts slice 1 and 2 one sample before the guard ends)
+  size_t slice_start(int slice) const
+  {
+    return slice == 0 ? 0 : slice * samples_per_freq + guard_interval - 1;
+  }
+
+  // centre of the slice in samples, where its correlation delay applies
+  double slice_centre(int slice) const
+  {
+    return static_cast<double>(slice_start(slice)) + 0.5 * static_cast<double>(samples_per_slice);
+  }
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "SmoothCorr.h"
+#include <iostream>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+int smooth_corr(const std::vector<double> &corr, int span, size_t lo, size_t hi,
+                std::vector<double> &smoothed, double &corr_max, bool normalize)
+{
+  size_t n = corr.size();
+  if (lo > hi || hi > n)
+  {
+    std::cerr << "Error: smoothing window outside of correlation!" << std::endl;
+    return 1;
+  }
+
+  smoothed.resize(hi - lo);
+  corr_max = -std::numeric_limits<double>::infinity();
+  if (hi == lo)
+    return 0;
+
+  double *out = smoothed.data();
+  const double *y = corr.data();
+
+  if (span == 0)
+  {
+    // no smoothing: MATLAB normalizes the signed correlation directly
+    for (size_t i = lo; i < hi; ++i)
+    {
+      out[i - lo] = y[i];
+      corr_max = std::max(corr_max, y[i]);
+    }
+  }
+  else
+  {
+    // MATLAB smooth: span is odd and not longer than the data,
+    // near the edges the window shrinks symmetrically (1, 3, 5, ... samples)
+    size_t span_eff = std::min(static_cast<size_t>(span), n);
+    if (span_eff % 2 == 0)
+      span_eff -= 1;
+    size_t h = (span_eff - 1) / 2;
+
+    const long long nn = static_cast<long long>(n);
+    const long long hh = static_cast<long long>(h);
+
+    // running sum of |y| over [left, right], starts empty
+    long long left = static_cast<long long>(lo), right = left - 1;
+    double sum = 0.0;
+    auto move_to = [&](long long i)
+    {
+      long long w = std::min(hh, std::min(i, nn - 1 - i));
+      while (right < i + w)
+        sum += std::fabs(y[++right]);
+      while (left > i - w)
+        sum += std::fabs(y[--left]);
+      while (right > i + w)
+        sum -= std::fabs(y[right--]);
+      while (left < i - w)
+        sum -= std::fabs(y[left++]);
+    };
+
+    // left edge [lo, a), interior [a, b) with full window, right edge [b, hi)
+    size_t a = std::min(std::max(lo, h), hi);
+    size_t b = std::max(std::min(hi, n - h), a);
+
+    size_t i = lo;
+    for (; i < a; ++i)
+    {
+      move_to(static_cast<long long>(i));
+      double v = sum / static_cast<double>(right - left + 1);
+      out[i - lo] = v;
+      corr_max = std::max(corr_max, v);
+    }
+
+    if (a < b)
+    {
+      // interior: constant-time update without branches
+      const double inv_span = 1.0 / static_cast<double>(span_eff);
+      move_to(static_cast<long long>(a));
+      double v = sum * inv_span;
+      out[a - lo] = v;
+      corr_max = std::max(corr_max, v);
+      for (i = a + 1; i < b; ++i)
+      {
+        sum += std::fabs(y[i + h]) - std::fabs(y[i - h - 1]);
+        v = sum * inv_span;
+        out[i - lo] = v;
+        corr_max = std::max(corr_max, v);
+      }
+      left = static_cast<long long>(b - 1 - h);
+      right = static_cast<long long>(b - 1 + h);
+    }
+
+    for (i = b; i < hi; ++i)
+    {
+      // shrinking edge
+      move_to(static_cast<long long>(i));
+      double v = sum / static_cast<double>(right - left + 1);
+      out[i - lo] = v;
+      corr_max = std::max(corr_max, v);
+    }
+  }
+
+  if (normalize && corr_max != 0.0)
+  {
+    const double scale = 1.0 / corr_max;
+    const size_t len = hi - lo;
+    for (size_t k = 0; k < len; ++k)
+      out[k] *= scale;
+  }
+
+  return 0;
+}
+
+int smooth_corr(const std::vector<double> &corr, int span, std::vector<double> &smoothed, double &corr_max, bool normalize)
+{
+  return smooth_corr(corr, span, 0, corr.size(), smoothed, corr_max, normalize);
+}
@@ -0,0 +1,17 @@
+#ifndef SMOOTH_CORR_H
+#define SMOOTH_CORR_H
+
+#include <vector>
+#include <cstddef>
+
+// smooth(abs(corr), span) followed by corr ./ max(corr), as done in correlate_iq.m
+// span: MATLAB smoothing factor (0 = no smoothing, even spans are reduced by 1)
+// lo, hi: only the outputs corr[lo..hi) are computed (lag window), smoothed[0] belongs to lo
+// corr_max: maximum of the (smoothed) window, tracked while smoothing
+int smooth_corr(const std::vector<double> &corr, int span, size_t lo, size_t hi,
+                std::vector<double> &smoothed, double &corr_max, bool normalize = true);
+
+// full length version
+int smooth_corr(const std::vector<double> &corr, int span, std::vector<double> &smoothed, double &corr_max, bool normalize = true);
+
+#endif
@@ -0,0 +1,231 @@
+#include "StreamCorrelator.h"
+#include "FFT.h"
+#include "PeakRefine.h"
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+StreamCorrelator::StreamCorrelator(const StreamConfig &config) : config_(config)
+{
+  config_.block_len = next_pow2(std::max<size_t>(config_.block_len, 2));
+  if (config_.max_lag == 0 || config_.max_lag >= config_.block_len)
+    config_.max_lag = config_.block_len - 1;
+
+  fft_len_ = 2 * config_.block_len;
+  bins_ = config_.block_len + 1;
+
+  double block_s = static_cast<double>(config_.block_len) / config_.sample_rate;
+  publish_every_ = std::max<size_t>(1, static_cast<size_t>(std::lround(1.0 / (config_.publish_hz * block_s))));
+  window_blocks_ = std::max<size_t>(1, static_cast<size_t>(std::lround(config_.integration_s / block_s)));
+  lambda_ = std::exp(-block_s / config_.integration_s);
+
+  work_.resize(fft_len_);
+  acc_.resize(bins_);
+  if (config_.forget_mode == FORGET_SLIDING)
+  {
+    ring_.resize(window_blocks_ * bins_);
+    energy_ring_.resize(window_blocks_ * 2);
+  }
+  reset();
+}
+
+void StreamCorrelator::reset()
+{
+  for (int rx = 0; rx < 2; ++rx)
+  {
+    pending_[rx].clear();
+    phase_old_[rx] = 0.0;
+    first_sample_[rx] = true;
+    energy_acc_[rx] = 0.0;
+  }
+  std::fill(acc_.begin(), acc_.end(), 0.0);
+  std::fill(ring_.begin(), ring_.end(), 0.0);
+  std::fill(energy_ring_.begin(), energy_ring_.end(), 0.0);
+  ring_pos_ = 0;
+  blocks_in_window_ = 0;
+  blocks_total_ = 0;
+  has_estimate_ = false;
+}
+
+int StreamCorrelator::push(int rx, const std::complex<float> *iq, size_t n)
+{
+  if (rx < 0 || rx > 1)
+  {
+    std::cerr << "Error: stream correlator has only receiver 0 and 1!" << std::endl;
+    return 1;
+  }
+
+  std::vector<double> &pending = pending_[rx];
+  if (pending.size() + n > config_.max_pending_blocks * config_.block_len)
+  {
+    std::cerr << "Error: receiver " << rx << " is too far ahead of the other stream!" << std::endl;
+    return 1;
+  }
+
+  // preprocessing per sample, dphase keeps the last phase across calls
+  size_t old_size = pending.size();
+  pending.resize(old_size + n);
+  double *x = pending.data() + old_size;
+  if (config_.corr_type == CORR_ABS)
+  {
+    for (size_t i = 0; i < n; ++i)
+      x[i] = std::abs(iq[i]);
+  }
+  else
+  {
+    double phase_old = phase_old_[rx];
+    if (n > 0 && first_sample_[rx])
+    {
+      phase_old = std::arg(iq[0]);
+      first_sample_[rx] = false;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+      double phase = std::arg(iq[i]);
+      double d = phase - phase_old;
+      if (d > M_PI)
+        d -= 2.0 * M_PI;
+      else if (d < -M_PI)
+        d += 2.0 * M_PI;
+      phase_old = phase;
+      x[i] = d;
+    }
+    phase_old_[rx] = phase_old;
+  }
+
+  while (pending_[0].size() >= config_.block_len && pending_[1].size() >= config_.block_len)
+  {
+    process_block();
+    for (int r = 0; r < 2; ++r)
+      pending_[r].erase(pending_[r].begin(), pending_[r].begin() + config_.block_len);
+  }
+  return 0;
+}
+
+void StreamCorrelator::process_block()
+{
+  const size_t b_len = config_.block_len;
+  const double *x = pending_[0].data();
+  const double *y = pending_[1].data();
+
+  // block mean removal and energies
+  double mx = 0.0, my = 0.0;
+  for (size_t i = 0; i < b_len; ++i)
+  {
+    mx += x[i];
+    my += y[i];
+  }
+  mx /= static_cast<double>(b_len);
+  my /= static_cast<double>(b_len);
+
+  double ex = 0.0, ey = 0.0;
+  for (size_t i = 0; i < b_len; ++i)
+  {
+    double xv = x[i] - mx, yv = y[i] - my;
+    ex += xv * xv;
+    ey += yv * yv;
+    work_[i] = std::complex<double>(xv, yv);
+  }
+  std::fill(work_.begin() + b_len, work_.end(), 0.0);
+  get_fft_plan(fft_len_).forward(work_);
+
+  std::complex<double> *slot = nullptr;
+  if (config_.forget_mode == FORGET_SLIDING)
+  {
+    slot = ring_.data() + ring_pos_ * bins_;
+    energy_acc_[0] -= energy_ring_[2 * ring_pos_];
+    energy_acc_[1] -= energy_ring_[2 * ring_pos_ + 1];
+    energy_ring_[2 * ring_pos_] = ex;
+    energy_ring_[2 * ring_pos_ + 1] = ey;
+    energy_acc_[0] += ex;
+    energy_acc_[1] += ey;
+  }
+  else
+  {
+    energy_acc_[0] = lambda_ * energy_acc_[0] + ex;
+    energy_acc_[1] = lambda_ * energy_acc_[1] + ey;
+  }
+
+  // unpack the two real spectra from z = x + i*y and add X * conj(Y)
+  for (size_t k = 0; k < bins_; ++k)
+  {
+    size_t kn = (fft_len_ - k) & (fft_len_ - 1);
+    std::complex<double> zk = work_[k], zn = std::conj(work_[kn]);
+    std::complex<double> xk = 0.5 * (zk + zn);
+    std::complex<double> yk = std::complex<double>(0.0, -0.5) * (zk - zn);
+    std::complex<double> s = xk * std::conj(yk);
+
+    if (slot)
+    {
+      acc_[k] += s - slot[k];
+      slot[k] = s;
+    }
+    else
+    {
+      acc_[k] = lambda_ * acc_[k] + s;
+    }
+  }
+
+  if (slot)
+  {
+    ring_pos_ = (ring_pos_ + 1) % window_blocks_;
+    if (ring_pos_ == 0)
+    {
+      // rebuild the running sum once per window so rounding errors do not accumulate
+      std::fill(acc_.begin(), acc_.end(), 0.0);
+      for (size_t w = 0; w < window_blocks_; ++w)
+        for (size_t k = 0; k < bins_; ++k)
+          acc_[k] += ring_[w * bins_ + k];
+    }
+  }
+
+  blocks_in_window_ = std::min(blocks_in_window_ + 1, window_blocks_);
+  ++blocks_total_;
+  if (blocks_total_ % publish_every_ == 0)
+    publish();
+}
+
+void StreamCorrelator::publish()
+{
+  // hermitian extension of the half spectrum, then one inverse fft
+  work_[0] = acc_[0];
+  for (size_t k = 1; k < bins_; ++k)
+  {
+    work_[k] = acc_[k];
+    work_[fft_len_ - k] = std::conj(acc_[k]);
+  }
+  work_[bins_ - 1] = acc_[bins_ - 1].real();
+  get_fft_plan(fft_len_).inverse(work_);
+
+  // lags -max_lag .. max_lag, lag m sits at m mod 2B
+  const size_t max_lag = config_.max_lag;
+  std::vector<double> lags(2 * max_lag + 1);
+  size_t idx = 0;
+  for (size_t i = 0; i < lags.size(); ++i)
+  {
+    size_t k = (i + fft_len_ - max_lag) & (fft_len_ - 1);
+    lags[i] = work_[k].real();
+    if (lags[i] > lags[idx])
+      idx = i;
+  }
+
+  PeakEstimate peak;
+  refine_peak(lags, idx, PEAK_FIT_PARABOLIC, peak);
+
+  double norm = std::sqrt(energy_acc_[0] * energy_acc_[1]);
+  latest_.time_s = static_cast<double>(blocks_total_ * config_.block_len) / config_.sample_rate;
+  latest_.delay_samples = peak.position - static_cast<double>(max_lag);
+  latest_.peak = norm > 0.0 ? peak.amplitude / norm : 0.0;
+  latest_.blocks = blocks_in_window_;
+  has_estimate_ = true;
+
+  if (callback_)
+    callback_(latest_);
+}
+
+bool StreamCorrelator::latest(StreamEstimate &estimate) const
+{
+  if (has_estimate_)
+    estimate = latest_;
+  return has_estimate_;
+}
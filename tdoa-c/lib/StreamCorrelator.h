@@ -0,0 +1,88 @@
+#ifndef STREAM_CORRELATOR_H
+#define STREAM_CORRELATOR_H
+
+#include <vector>
+#include <complex>
+#include <functional>
+#include <cstddef>
+#include "CorrelateIQ.h"
+
+// forgetting of old cross-spectra in the integration window
+enum ForgetMode
+{
+  FORGET_EXPONENTIAL, // acc = lambda * acc + S, time constant = integration window
+  FORGET_SLIDING      // sum of the last W block spectra (ring buffer)
+};
+
+struct StreamConfig
+{
+  size_t block_len = 65536;     // B, samples per block and receiver (power of two)
+  CorrType corr_type = CORR_DPHASE;
+  ForgetMode forget_mode = FORGET_EXPONENTIAL;
+  double integration_s = 0.5;   // integration window in seconds
+  double publish_hz = 10.0;     // rate of delay estimates
+  double sample_rate = 2e6;     // Hz
+  size_t max_lag = 0;           // searched lags +-max_lag, 0: +-(B-1)
+  size_t max_pending_blocks = 8; // per receiver, push() fails beyond this
+};
+
+struct StreamEstimate
+{
+  double time_s;        // stream time at the end of the last integrated block
+  double delay_samples; // >0: signal1 later than signal2 (fractional)
+  double peak;          // correlation peak normalized to the accumulated energies
+  size_t blocks;        // number of blocks contributing to the window
+};
+
+// incremental cross-correlation of two receiver streams
+// every block pair of B samples is zero padded to 2B and its cross spectrum is added to the
+// integration window, so the correlations of all blocks overlap-add at equal lags
+// (lag |m| loses the fraction |m|/B of cross-block products, choose B >> expected delay)
+// per block cost: one 2B point fft, memory is independent of the stream length
+class StreamCorrelator
+{
+public:
+  explicit StreamCorrelator(const StreamConfig &config);
+
+  // append samples of receiver rx (0 or 1), processes all complete block pairs
+  // returns 1 if a receiver runs more than max_pending_blocks ahead of the other
+  int push(int rx, const std::complex<float> *iq, size_t n);
+
+  // called for every published estimate
+  void set_callback(std::function<void(const StreamEstimate &)> callback) { callback_ = std::move(callback); }
+
+  // latest published estimate, false if none yet
+  bool latest(StreamEstimate &estimate) const;
+
+  void reset();
+
+private:
+  void process_block();
+  void publish();
+
+  StreamConfig config_;
+  size_t fft_len_;         // 2B
+  size_t bins_;            // B + 1, the correlation is real so half the spectrum is stored
+  size_t publish_every_;   // blocks between estimates
+  size_t window_blocks_;   // W for FORGET_SLIDING
+  double lambda_;          // forgetting factor for FORGET_EXPONENTIAL
+
+  std::vector<double> pending_[2]; // preprocessed samples not yet in a block
+  double phase_old_[2];            // dphase state across blocks
+  bool first_sample_[2];           // no sample yet since reset: dphase starts with 0 as in prepare_iq
+
+  std::vector<std::complex<double>> work_;  // fft buffer
+  std::vector<std::complex<double>> acc_;   // accumulated cross spectrum (bins_)
+  std::vector<std::complex<double>> ring_;  // W * bins_ block spectra for FORGET_SLIDING
+  double energy_acc_[2];
+  std::vector<double> energy_ring_;         // W * 2 block energies
+  size_t ring_pos_;
+  size_t blocks_in_window_;
+  size_t blocks_total_;
+
+  std::function<void(const StreamEstimate &)> callback_;
+  StreamEstimate latest_;
+  bool has_estimate_;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "Sweep.h"
+#include "FilterIQ.h"
+#include "Memo.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+namespace
+{
+  using IQSpan = std::span<const std::complex<float>>;
+
+  std::string node_key(std::initializer_list<int> params)
+  {
+    std::string key;
+    for (int p : params)
+      key += std::to_string(p) + "/";
+    return key;
+  }
+
+  // dependency graph of one sweep, every stage pulls its inputs from the memo of the stage before
+  class SweepGraph
+  {
+  public:
+    SweepGraph(IQSpan signal1, IQSpan signal2, double rx_distance_diff, double rx_distance, const Tdoa2Config &base,
+               long margin)
+        : base_(base), rx_distance_diff_(rx_distance_diff), rx_distance_(rx_distance), margin_(margin),
+          n_(static_cast<long>(base.layout.samples_per_slice))
+    {
+      signals_[0] = signal1;
+      signals_[1] = signal2;
+    }
+
+    // slice k of receiver rx, filtered to bandwidth_khz (view of the capture for 0)
+    std::shared_ptr<const std::vector<std::complex<float>>> filtered(int rx, int k, int bandwidth_khz)
+    {
+      return filtered_.get(node_key({rx, k, bandwidth_khz}), [&](std::vector<std::complex<float>> &out)
+      {
+        if (filter_iq(slice(rx, k), out, bandwidth_khz, base_.report))
+        {
+          std::cout << "no filtering performed!" << std::endl;
+          IQSpan s = slice(rx, k);
+          out.assign(s.begin(), s.end());
+        }
+        return 0;
+      });
+    }
+
+    std::shared_ptr<const PreparedIQ> prepared(int rx, int k, int bandwidth_khz, CorrType corr_type)
+    {
+      return prepared_.get(node_key({rx, k, bandwidth_khz, corr_type}), [&](PreparedIQ &out)
+      {
+        if (bandwidth_khz == 0)
+          return prepare_iq(slice(rx, k).data(), slice(rx, k).size(), corr_type, out);
+        auto f = filtered(rx, k, bandwidth_khz);
+        return f ? prepare_iq(*f, corr_type, out) : 1;
+      });
+    }
+
+    // reference slices 0 and 2 with the reference bandwidth, smoothing and correlation of the base config
+    std::shared_ptr<const RefCorr> ref(int k, CorrType corr_type)
+    {
+      return ref_.get(node_key({k, corr_type}), [&](RefCorr &out)
+      {
+        auto a = prepared(0, k, base_.ref_bandwidth_khz, corr_type);
+        auto b = prepared(1, k, base_.ref_bandwidth_khz, corr_type);
+        Tdoa2Config config = base_;
+        config.corr_type = corr_type;
+        return a && b ? tdoa2_ref_corr(*a, *b, config, out, slice(0, k), slice(1, k)) : 1;
+      });
+    }
+
+    ValidWindow valid(const RefCorr &ref1) const
+    {
+      return tdoa2_valid_window(ref1.idx_offset + ref1.idx, n_, rx_distance_diff_, rx_distance_, base_.layout.sample_rate);
+    }
+
+    std::shared_ptr<const LagWindow> raw(int bandwidth_khz, CorrType corr_type)
+    {
+      return raw_.get(node_key({bandwidth_khz, corr_type}), [&](LagWindow &out)
+      {
+        auto ref1 = ref(0, corr_type);
+        auto a = prepared(0, 1, bandwidth_khz, corr_type);
+        auto b = prepared(1, 1, bandwidth_khz, corr_type);
+        return ref1 && a && b ? tdoa2_measure_raw(*a, *b, valid(*ref1), margin_, base_.corr_segment_len, out) : 1;
+      });
+    }
+
+    std::shared_ptr<const MeasureCorr> measure(int bandwidth_khz, CorrType corr_type, int smoothing)
+    {
+      return measure_.get(node_key({bandwidth_khz, corr_type, smoothing}), [&](MeasureCorr &out)
+      {
+        auto ref1 = ref(0, corr_type);
+        auto r = raw(bandwidth_khz, corr_type);
+        return ref1 && r ? tdoa2_measure_corr(*r, n_, valid(*ref1), smoothing, out) : 1;
+      });
+    }
+
+    // per config: peak interpolation and merge
+    int evaluate(const Tdoa2Config &config, Tdoa2Result &result)
+    {
+      auto ref1 = ref(0, config.corr_type);
+      auto ref3 = ref(2, config.corr_type);
+      auto m = measure(config.signal_bandwidth_khz, config.corr_type, config.smoothing_factor);
+      if (!ref1 || !ref3 || !m)
+        return 1;
+
+      double interp1, interp2, interp3;
+      if (tdoa2_peak_delay(ref1->corr, ref1->idx, ref1->idx_offset, n_, config.interpol, result.delay1, interp1) ||
+          tdoa2_peak_delay(m->corr, m->idx, valid(*ref1).lo, n_, config.interpol, result.delay2, interp2) ||
+          tdoa2_peak_delay(ref3->corr, ref3->idx, ref3->idx_offset, n_, config.interpol, result.delay3, interp3))
+        return 1;
+      if (config.interpol > 1)
+      {
+        result.delay1 = interp1;
+        result.delay2 = interp2;
+        result.delay3 = interp3;
+      }
+      result.reliability1 = ref1->reliability;
+      result.reliability2 = m->reliability;
+      result.reliability3 = ref3->reliability;
+      tdoa2_combine(config, rx_distance_diff_, result);
+      return 0;
+    }
+
+    SweepStats stats() const
+    {
+      SweepStats s;
+      s.computed = filtered_.computed() + prepared_.computed() + ref_.computed() + raw_.computed() + measure_.computed();
+      s.reused = filtered_.reused() + prepared_.reused() + ref_.reused() + raw_.reused() + measure_.reused();
+      return s;
+    }
+
+  private:
+    IQSpan slice(int rx, int k) const
+    {
+      return signals_[rx].subspan(base_.layout.slice_start(k), base_.layout.samples_per_slice);
+    }
+
+    IQSpan signals_[2];
+    const Tdoa2Config &base_;
+    double rx_distance_diff_;
+    double rx_distance_;
+    long margin_;
+    long n_;
+
+    Memo<std::vector<std::complex<float>>> filtered_;
+    Memo<PreparedIQ> prepared_;
+    Memo<RefCorr> ref_;
+    Memo<LagWindow> raw_;
+    Memo<MeasureCorr> measure_;
+  };
+}
+
+int tdoa2_sweep(std::span<const std::complex<float>> signal1, std::span<const std::complex<float>> signal2,
+                double rx_distance_diff, double rx_distance, const Tdoa2Config &base, const SweepGrid &grid,
+                std::vector<SweepPoint> &points, SweepStats &stats, unsigned num_threads)
+{
+  const SliceLayout &layout = base.layout;
+  if (signal1.size() != layout.total() || signal2.size() != layout.total())
+  {
+    std::cerr << "Error: Length of the signals is unequal " << layout.total() << std::endl;
+    return 1;
+  }
+  if (layout.samples_per_slice < 2 || layout.slice_start(2) + layout.samples_per_slice > layout.total())
+  {
+    std::cerr << "Error: slices do not fit into the capture!" << std::endl;
+    return 1;
+  }
+  if (grid.bandwidth_khz.empty() || grid.corr_type.empty() || grid.smoothing.empty() || grid.interpol.empty())
+  {
+    std::cerr << "Error: empty sweep grid!" << std::endl;
+    return 1;
+  }
+  // the measurement slices are shared by all points, a resampled one would depend on the references of a point
+  if (base.drift_compensation == DRIFT_RESAMPLE)
+  {
+    std::cerr << "Error: the sweep does not resample the measurement slice (drift_compensation)!" << std::endl;
+    return 1;
+  }
+  // the grid only changes the measurement correlation
+  if (base.measure_template)
+  {
+    std::cerr << "Error: the sweep has no matched filter measurement (template_file)!" << std::endl;
+    return 1;
+  }
+
+  // one raw measurement window serves all smoothing factors
+  long margin = 0;
+  for (int smoothing : grid.smoothing)
+    margin = std::max(margin, smoothing > 0 ? static_cast<long>(smoothing - 1) / 2 : 0L);
+
+  points.clear();
+  for (int bandwidth : grid.bandwidth_khz)
+    for (CorrType corr_type : grid.corr_type)
+      for (int smoothing : grid.smoothing)
+        for (int interpol : grid.interpol)
+        {
+          SweepPoint point;
+          point.config = base;
+          point.config.signal_bandwidth_khz = bandwidth;
+          point.config.corr_type = corr_type;
+          point.config.smoothing_factor = smoothing;
+          point.config.interpol = interpol;
+          point.ok = false;
+          points.push_back(point);
+        }
+
+  SweepGraph graph(signal1, signal2, rx_distance_diff, rx_distance, base, margin);
+  std::atomic<size_t> next{0};
+  auto worker = [&]()
+  {
+    for (size_t i = next++; i < points.size(); i = next++)
+      points[i].ok = graph.evaluate(points[i].config, points[i].result) == 0;
+  };
+
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = static_cast<unsigned>(std::min<size_t>(num_threads, points.size()));
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < num_threads; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+
+  stats = graph.stats();
+  return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <vector>
+#include <complex>
+#include <span>
+#include <cstddef>
+#include "Tdoa2.h"
+
+// parameter grid of a sweep, every combination is one tdoa2 run
+// bandwidth: signal_bandwidth_khz of the measurement slice, smoothing: smoothing_factor of the measurement
+// (ref bandwidth, ref smoothing, layout and drift settings come from the base config,
+// drift_compensation = resample and template_file are not supported)
+struct SweepGrid
+{
+  std::vector<int> bandwidth_khz;
+  std::vector<CorrType> corr_type;
+  std::vector<int> smoothing;
+  std::vector<int> interpol;
+};
+
+struct SweepPoint
+{
+  Tdoa2Config config;
+  bool ok; // false if one of the stages failed
+  Tdoa2Result result;
+};
+
+// nodes of the dependency graph computed / taken from the memo
+struct SweepStats
+{
+  size_t computed;
+  size_t reused;
+};
+
+// tdoa2 for every grid combination on the same capture pair
+// stages shared by several configs run once: filtered slices (rx, slice, bandwidth), abs/dphase
+// sequences (+ corr_type), reference correlations (slice, corr_type), raw measurement correlation
+// (bandwidth, corr_type, over the valid area plus the largest smoothing span of the grid),
+// smoothed measurement correlation (+ smoothing); only peak interpolation and merge are per config
+// configs are evaluated in parallel (num_threads 0: all cores), points are in grid order
+// (bandwidth outermost, interpol innermost), the results equal Tdoa2::run with the same config
+int tdoa2_sweep(std::span<const std::complex<float>> signal1, std::span<const std::complex<float>> signal2,
+                double rx_distance_diff, double rx_distance, const Tdoa2Config &base, const SweepGrid &grid,
+                std::vector<SweepPoint> &points, SweepStats &stats, unsigned num_threads = 0);
+
+#endif
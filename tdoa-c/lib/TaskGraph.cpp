@@ -0,0 +1,129 @@
+#include "TaskGraph.h"
+#include "Trace.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+TaskGraph::TaskId TaskGraph::add(const std::string &name, std::function<int()> task, const std::vector<TaskId> &deps,
+                                 const std::string &stage)
+{
+  TaskId id = nodes_.size();
+  auto node = std::make_unique<Node>();
+  node->name = name;
+  node->stage = stage.empty() ? name : stage;
+  node->task = std::move(task);
+  for (TaskId dep : deps)
+  {
+    if (dep >= id)
+    {
+      std::cerr << "Error: task " << name << " depends on unknown task " << dep << std::endl;
+      invalid_ = true;
+      continue;
+    }
+    nodes_[dep]->successors.push_back(id);
+    ++node->num_deps;
+  }
+  nodes_.push_back(std::move(node));
+  return id;
+}
+
+void TaskGraph::execute(ThreadPool &pool, Node &node)
+{
+  node.timing.name = node.name;
+  node.timing.stage = node.stage;
+  if (node.skip)
+  {
+    node.timing.worker = -1;
+    node.timing.start_ms = node.timing.duration_ms = 0.0;
+    node.timing.ok = false;
+  }
+  else
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    node.timing.ok = node.task() == 0;
+    auto t1 = std::chrono::steady_clock::now();
+    trace_event(node.name.c_str(), node.stage.c_str(), t0, t1);
+    node.timing.worker = pool.worker_index();
+    node.timing.start_ms = std::chrono::duration<double, std::milli>(t0 - start_).count();
+    node.timing.duration_ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+  }
+  if (!node.timing.ok)
+    ++failed_;
+
+  for (TaskId s : node.successors)
+  {
+    Node &next = *nodes_[s];
+    if (!node.timing.ok)
+      next.skip = true;
+    if (--next.remaining == 0)
+      pool.submit([this, &pool, &next]() { execute(pool, next); });
+  }
+
+  std::lock_guard<std::mutex> lock(done_mutex_);
+  if (--pending_ == 0)
+    done_.notify_all();
+}
+
+int TaskGraph::run(ThreadPool &pool)
+{
+  if (invalid_)
+    return 1;
+  if (nodes_.empty())
+    return 0;
+
+  for (auto &node : nodes_)
+  {
+    node->remaining = node->num_deps;
+    node->skip = false;
+  }
+  failed_ = 0;
+  pending_ = nodes_.size();
+  num_workers_ = pool.size();
+  start_ = std::chrono::steady_clock::now();
+
+  for (auto &node : nodes_)
+    if (node->num_deps == 0)
+    {
+      Node *root = node.get();
+      pool.submit([this, &pool, root]() { execute(pool, *root); });
+    }
+
+  std::unique_lock<std::mutex> lock(done_mutex_);
+  done_.wait(lock, [this]() { return pending_ == 0; });
+  wall_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+  return failed_ ? 1 : 0;
+}
+
+std::vector<TaskTiming> TaskGraph::timings() const
+{
+  std::vector<TaskTiming> t;
+  for (const auto &node : nodes_)
+    t.push_back(node->timing);
+  return t;
+}
+
+void TaskGraph::print_timings() const
+{
+  std::vector<TaskTiming> t = timings();
+  std::stable_sort(t.begin(), t.end(), [](const TaskTiming &a, const TaskTiming &b) { return a.start_ms < b.start_ms; });
+
+  std::vector<double> busy(num_workers_, 0.0);
+  std::cout << "task                          worker  start_ms  duration_ms" << std::endl;
+  for (const TaskTiming &x : t)
+  {
+    std::cout << std::left << std::setw(30) << x.name << std::right;
+    if (x.worker < 0)
+    {
+      std::cout << "skipped" << std::endl;
+      continue;
+    }
+    std::cout << std::setw(6) << x.worker << std::fixed << std::setprecision(1) << std::setw(10) << x.start_ms
+              << std::setw(13) << x.duration_ms << (x.ok ? "" : "  failed") << std::defaultfloat << std::endl;
+    if (static_cast<size_t>(x.worker) < busy.size())
+      busy[x.worker] += x.duration_ms;
+  }
+  std::cout << "wall time " << std::fixed << std::setprecision(1) << wall_ms_ << " ms, busy per worker:";
+  for (double b : busy)
+    std::cout << " " << b;
+  std::cout << " ms" << std::defaultfloat << std::endl;
+}
@@ -0,0 +1,77 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include "ThreadPool.h"
+
+// timing of one task of the last run, times in ms relative to the start of run()
+struct TaskTiming
+{
+  std::string name;
+  std::string stage; // group for utilization statistics (e.g. "read", "pair")
+  int worker;  // pool worker that ran the task, -1 if skipped
+  double start_ms;
+  double duration_ms;
+  bool ok;     // false if the task failed or was skipped because a dependency failed
+};
+
+// DAG of tasks on a ThreadPool: a task is submitted as soon as all its dependencies are done,
+// so independent stages overlap, a failed task (return value != 0) skips all tasks depending on it
+// dependencies are given by id and must be added first (the graph is acyclic by construction)
+class TaskGraph
+{
+public:
+  using TaskId = size_t;
+
+  // stage: group of the task in the timings, the name if empty
+  TaskId add(const std::string &name, std::function<int()> task, const std::vector<TaskId> &deps = {},
+             const std::string &stage = "");
+
+  size_t size() const { return nodes_.size(); }
+
+  // runs all tasks and waits for them, must not be called from a task of the same pool
+  // returns 1 if any task failed or was skipped
+  int run(ThreadPool &pool);
+
+  // per task timings of the last run (task id order)
+  std::vector<TaskTiming> timings() const;
+
+  // table of the timings sorted by start, plus busy time per worker
+  void print_timings() const;
+
+private:
+  struct Node
+  {
+    std::string name;
+    std::string stage;
+    std::function<int()> task;
+    std::vector<TaskId> successors;
+    size_t num_deps = 0;
+    std::atomic<size_t> remaining{0};
+    std::atomic<bool> skip{false};
+    TaskTiming timing;
+  };
+
+  void execute(ThreadPool &pool, Node &node);
+
+  std::vector<std::unique_ptr<Node>> nodes_;
+  bool invalid_ = false; // a dependency id was unknown when adding
+
+  std::chrono::steady_clock::time_point start_;
+  std::mutex done_mutex_;
+  std::condition_variable done_;
+  size_t pending_ = 0; // guarded by done_mutex_
+  std::atomic<int> failed_{0};
+  double wall_ms_ = 0.0;
+  unsigned num_workers_ = 0;
+};
+
+#endif
@@ -0,0 +1,508 @@
+#include "Tdoa2.h"
+#include "FilterIQ.h"
+#include "SmoothCorr.h"
+#include "CorrReliability.h"
+#include "PeakRefine.h"
+#include "WelchCorr.h"
+#include "DabTiming.h"
+#include "Resampler.h"
+#include "Trace.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <algorithm>
+
+namespace
+{
+  const double SPEED_OF_LIGHT = 3e8;
+
+  // half overlapping welch segments (as bench_welch)
+  size_t welch_overlap(size_t segment_len)
+  {
+    return segment_len / 2;
+  }
+
+  // half span of the reference smoothing: a smoothed lag needs the raw lags +- this around it
+  long smoothing_half(const Tdoa2Config &config)
+  {
+    return config.smoothing_factor_ref > 0 ? (config.smoothing_factor_ref - 1) / 2 : 0;
+  }
+
+  // correlate_iq_finish, reliability and peak of a raw lag window, n: slice length
+  // margin: raw lags on both sides that only support the smoothing, they are dropped from the result
+  // unless the window ends at the end of the correlation (there the full correlation shrinks the span)
+  int finish_ref_window(const PreparedIQ &a, const PreparedIQ &b, const Tdoa2Config &config, long n, long margin,
+                        LagWindow &raw, RefCorr &ref)
+  {
+    const long size = static_cast<long>(raw.corr.size());
+    const long lo = raw.lag_lo > -(n - 1) ? margin : 0;
+    const long hi = raw.lag_lo + size - 1 < n - 1 ? size - margin : size;
+    ref.stats.peak = raw.peak;
+    ref.idx_offset = raw.lag_lo + (n - 1);
+    if (config.smoothing_factor_ref == 0 || (lo == 0 && hi == size))
+    {
+      ref.corr.swap(raw.corr);
+      if (correlate_iq_finish(a, b, config.corr_type, config.smoothing_factor_ref, ref.corr, ref.stats, false))
+        return 1;
+    }
+    else
+    {
+      // the lags lo..hi are smoothed over the same raw lags as in the full correlation
+      double corr_max;
+      if (correlate_iq_finish(a, b, config.corr_type, 0, raw.corr, ref.stats, false) ||
+          smooth_corr(raw.corr, config.smoothing_factor_ref, static_cast<size_t>(lo), static_cast<size_t>(hi),
+                      ref.corr, corr_max))
+        return 1;
+      ref.idx_offset += lo;
+    }
+    ref.reliability = corr_reliability(ref.corr);
+    ref.idx = std::max_element(ref.corr.begin(), ref.corr.end()) - ref.corr.begin();
+    return 0;
+  }
+}
+
+bool tdoa2_full_ref(const Tdoa2Config &config)
+{
+  return config.corr_segment_len == 0 && config.corr_mode == CORR_MODE_FULL;
+}
+
+int tdoa2_ref_corr(const PreparedIQ &a, const PreparedIQ &b, const Tdoa2Config &config, RefCorr &ref,
+                   std::span<const std::complex<float>> iq_a, std::span<const std::complex<float>> iq_b)
+{
+  const long n = static_cast<long>(std::max(a.seq.size(), b.seq.size()));
+  if (config.corr_segment_len > 0)
+  {
+    LagWindow raw;
+    if (xcorr_welch(a, b, config.corr_segment_len, welch_overlap(config.corr_segment_len), raw.corr, raw.peak, 1))
+      return 1;
+    raw.lag_lo = -static_cast<long>(raw.corr.size() / 2);
+    return finish_ref_window(a, b, config, n, 0, raw, ref);
+  }
+  if (config.corr_mode == CORR_MODE_COARSE_FINE)
+  {
+    // the smoothed maximum may lie up to half a span beside the raw one, search that much wider
+    // and correlate another half span on both sides for the smoothing
+    const long half = smoothing_half(config);
+    CoarseFineConfig coarse_fine;
+    coarse_fine.margin = 2 * half;
+    LagWindow raw;
+    double coarse_reliability;
+    bool fallback;
+    if (xcorr_coarse_fine(a, b, coarse_fine, raw, coarse_reliability, fallback, config.report) ||
+        finish_ref_window(a, b, config, n, half, raw, ref))
+      return 1;
+    if (!fallback)
+      ref.reliability = std::min(ref.reliability, coarse_reliability);
+    return 0;
+  }
+  if (config.corr_mode == CORR_MODE_DAB)
+  {
+    if (iq_a.size() != a.seq.size() || iq_b.size() != b.seq.size() || iq_a.size() != iq_b.size())
+    {
+      std::cerr << "Error: DAB timing needs the iq samples of the reference slices!" << std::endl;
+      return 1;
+    }
+    // as wide as the coarse-fine window, widened for the smoothing like there
+    const long half = smoothing_half(config);
+    DabConfig dab;
+    dab.sample_rate = config.layout.sample_rate;
+    dab.refine_lags = 32 + 2 * half;
+    LagWindow raw;
+    DabTiming timing;
+    if (dab_timing(iq_a.data(), iq_b.data(), iq_a.size(), a, b, dab, raw, timing, config.report) ||
+        finish_ref_window(a, b, config, n, half, raw, ref))
+      return 1;
+    if (timing.detected)
+    {
+      double coarse_reliability;
+      if (xcorr_coarse_reliability(a, b, CoarseFineConfig().decimation, coarse_reliability))
+        return 1;
+      ref.reliability = std::min(ref.reliability, coarse_reliability);
+    }
+    return 0;
+  }
+
+  if (correlate_iq(a, b, config.corr_type, config.smoothing_factor_ref, ref.corr, ref.stats, false))
+    return 1;
+  ref.idx_offset = 0;
+  ref.reliability = corr_reliability(ref.corr);
+  ref.idx = std::max_element(ref.corr.begin(), ref.corr.end()) - ref.corr.begin();
+  return 0;
+}
+
+int tdoa2_peak_delay(const std::vector<double> &corr, size_t idx, long idx_offset, long n, int interpol,
+                     double &delay_native, double &delay_interp)
+{
+  TraceSpan span("peak search");
+  delay_native = static_cast<double>(idx_offset + static_cast<long>(idx) - (n - 1));
+  delay_interp = 0.0;
+  if (interpol > 1)
+  {
+    PeakEstimate estimate;
+    if (refine_peak(corr, idx, PEAK_FIT_FFT_UPSAMPLE, estimate, 0.0, interpol))
+      return 1;
+    delay_interp = static_cast<double>(idx_offset) + estimate.position - static_cast<double>(n - 1);
+  }
+  return 0;
+}
+
+ValidWindow tdoa2_valid_window(size_t idx1, long n, double rx_distance_diff, double rx_distance, double sample_rate)
+{
+  // +1 for safety if rounding down and +2 for possible frequency drift
+  double valid_samples_right = (rx_distance - rx_distance_diff) / (SPEED_OF_LIGHT / sample_rate);
+  double valid_samples_left = -(-rx_distance - rx_distance_diff) / (SPEED_OF_LIGHT / sample_rate);
+  long steps_right = std::max(0L, static_cast<long>(std::floor(valid_samples_right + 1 + 2)));
+  long steps_left = std::max(0L, static_cast<long>(std::floor(valid_samples_left + 1 + 2)));
+
+  ValidWindow valid;
+  valid.lo = std::max(0L, static_cast<long>(idx1) - steps_left);
+  valid.hi = std::min(2 * n - 2, static_cast<long>(idx1) + steps_right);
+  return valid;
+}
+
+int tdoa2_measure_raw(const PreparedIQ &a, const PreparedIQ &b, const ValidWindow &valid, long margin,
+                      size_t segment_len, LagWindow &raw)
+{
+  TraceSpan span("xcorr window");
+  long n = static_cast<long>(std::max(a.seq.size(), b.seq.size()));
+  long win_lo = std::max(0L, valid.lo - margin);
+  long win_hi = std::min(2 * n - 2, valid.hi + margin);
+  if (segment_len == 0)
+  {
+    raw.lag_lo = win_lo - (n - 1);
+    return xcorr_window(a, b, raw.lag_lo, win_hi - (n - 1), raw.corr, raw.peak);
+  }
+
+  // the welch average covers the correlation indices n-1 +-(segment - 1), cut to the window
+  std::vector<double> corr;
+  double peak;
+  if (xcorr_welch(a, b, segment_len, welch_overlap(segment_len), corr, peak, 1))
+    return 1;
+  long lags = static_cast<long>(corr.size() / 2);
+  if (valid.lo < n - 1 - lags || valid.hi > n - 1 + lags)
+  {
+    std::cerr << "Error: valid area exceeds the welch lags +-" << lags << " (corr_segment_len)!" << std::endl;
+    return 1;
+  }
+  win_lo = std::max(win_lo, n - 1 - lags);
+  win_hi = std::min(win_hi, n - 1 + lags);
+  raw.lag_lo = win_lo - (n - 1);
+  raw.corr.assign(corr.begin() + (raw.lag_lo + lags), corr.begin() + (win_hi - (n - 1) + lags + 1));
+  raw.peak = *std::max_element(raw.corr.begin(), raw.corr.end());
+  return 0;
+}
+
+LagPrior tdoa2_lag_prior(const LagPrior &doa_prior, size_t ref_idx, long n, double rx_distance_diff, double sample_rate)
+{
+  // doa_samples = delay2 - ref_delay + ref_signal_diff_samples
+  double ref_delay = static_cast<double>(static_cast<long>(ref_idx) - (n - 1));
+  double ref_signal_diff_samples = (rx_distance_diff / SPEED_OF_LIGHT) * sample_rate;
+  return LagPrior{doa_prior.center + ref_delay - ref_signal_diff_samples, doa_prior.tolerance};
+}
+
+int tdoa2_measure_prior(const LagCorrelator &correlate, long n, const ValidWindow &valid, const LagPrior &lag_prior,
+                        long margin, bool report, LagWindow &raw, ValidWindow &searched)
+{
+  TraceSpan span("xcorr prior");
+  LagWindow window;
+  double reliability;
+  int widenings;
+  if (xcorr_prior(correlate, lag_prior, PriorSearchConfig(), valid.lo - (n - 1), valid.hi - (n - 1), window,
+                  reliability, widenings, report))
+    return 1;
+  searched.lo = window.lag_lo + (n - 1);
+  searched.hi = searched.lo + static_cast<long>(window.corr.size()) - 1;
+
+  // the smoothing margin needs a second (slightly wider) window
+  long win_lo = std::max(0L, searched.lo - margin);
+  long win_hi = std::min(2 * n - 2, searched.hi + margin);
+  if (win_lo == searched.lo && win_hi == searched.hi)
+  {
+    raw = std::move(window);
+    return 0;
+  }
+  raw.lag_lo = win_lo - (n - 1);
+  return correlate(raw.lag_lo, win_hi - (n - 1), raw.corr, raw.peak);
+}
+
+int tdoa2_measure_corr(const LagWindow &raw, long n, const ValidWindow &valid, int smoothing_factor, MeasureCorr &measure)
+{
+  long raw_lo = raw.lag_lo + (n - 1);
+  double corr_max;
+  if (valid.lo < raw_lo || valid.hi >= raw_lo + static_cast<long>(raw.corr.size()) ||
+      smooth_corr(raw.corr, smoothing_factor, static_cast<size_t>(valid.lo - raw_lo),
+                  static_cast<size_t>(valid.hi - raw_lo + 1), measure.corr, corr_max, false))
+  {
+    std::cerr << "Error: measurement correlation does not cover the valid area!" << std::endl;
+    return 1;
+  }
+
+  // normalized to the valid area, maximum and reliability do not depend on a positive scale
+  if (corr_max > 0.0)
+    for (double &v : measure.corr)
+      v /= corr_max;
+  measure.reliability = corr_reliability(measure.corr);
+  measure.idx = std::max_element(measure.corr.begin(), measure.corr.end()) - measure.corr.begin();
+  return 0;
+}
+
+int tdoa2_resample_measure(std::span<const std::complex<float>> iq2, const Tdoa2Config &config, const DriftModel &model,
+                           PreparedIQ &prepared)
+{
+  const size_t n = iq2.size();
+  std::vector<std::complex<float>> resampled;
+  resampled.reserve(n + 1);
+  FarrowResampler resampler(1.0 / drift_ratio(model));
+  resampler.process(iq2.data(), n, resampled);
+  resampled.resize(n);
+
+  if (config.signal_bandwidth_khz != 0)
+  {
+    std::vector<std::complex<float>> filtered;
+    if (filter_iq(resampled, filtered, config.signal_bandwidth_khz, config.report))
+      std::cout << "no filtering performed!" << std::endl;
+    else
+      resampled.swap(filtered);
+  }
+  return prepare_iq(resampled, config.corr_type, prepared);
+}
+
+int tdoa2_measure_arrival(std::span<const std::complex<float>> iq, const Tdoa2Config &config, Arrival &arrival)
+{
+  if (!config.measure_template)
+  {
+    std::cerr << "Error: no matched filter template!" << std::endl;
+    return 1;
+  }
+  PeakFit fit = config.interpol > 1 ? PEAK_FIT_FFT_UPSAMPLE : PEAK_FIT_NONE;
+  return matched_filter_arrival(iq, *config.measure_template, fit, arrival, config.interpol);
+}
+
+void tdoa2_arrival_delay(const Arrival &arrival1, const Arrival &arrival2, const Tdoa2Config &config,
+                         double &delay_native, double &delay_interp, double &reliability)
+{
+  auto native = [](const Arrival &arrival)
+  {
+    return arrival.first + (std::max_element(arrival.mag.begin(), arrival.mag.end()) - arrival.mag.begin());
+  };
+  delay_native = static_cast<double>(native(arrival1) - native(arrival2));
+  delay_interp = config.interpol > 1 ? arrival1.position - arrival2.position : 0.0;
+  reliability = std::min(corr_reliability(arrival1.mag), corr_reliability(arrival2.mag));
+}
+
+void tdoa2_combine(const Tdoa2Config &config, double rx_distance_diff, Tdoa2Result &result)
+{
+  const SliceLayout &layout = config.layout;
+  result.drift_ppm = (result.delay3 - result.delay1) / (layout.slice_centre(2) - layout.slice_centre(0)) * 1e6;
+
+  if (config.drift_compensation != DRIFT_OFF)
+  {
+    DriftModel model;
+    result.ref_delay = ref_delay_at_measurement(result.delay1, result.reliability1, result.delay3,
+                                                result.reliability3, layout, config.max_drift_ppm, model);
+    if (config.drift_compensation == DRIFT_RESAMPLE && !config.measure_template)
+      result.ref_delay = drift_delay_at(model, static_cast<double>(layout.slice_start(1)));
+  }
+  else if (std::fabs(result.delay1 - result.delay3) <= 2)
+  {
+    // this delay includes: 1) different reception start time 2) ref signal delay due to different distances to ref transmitter
+    result.ref_delay = (result.delay1 + result.delay3) / 2;
+  }
+  else
+  {
+    std::cout << "WARNING: BAD REFERENCE SIGNALS: ref delays differ by more than 2 samples!" << std::endl;
+    if (result.reliability1 > result.reliability3)
+    {
+      result.ref_delay = result.delay1;
+      std::cout << "taking ref with higher reliability, i.e. ref (reliability: " << result.reliability1 << "(ref) > "
+                << result.reliability3 << "(ref check)" << std::endl;
+    }
+    else
+    {
+      result.ref_delay = result.delay3;
+      std::cout << "taking ref with higher reliability, i.e. ref check (reliability: " << result.reliability1
+                << "(ref) < " << result.reliability3 << "(ref check)" << std::endl;
+    }
+  }
+
+  double ref_signal_diff_samples = (rx_distance_diff / SPEED_OF_LIGHT) * layout.sample_rate; // known ref signal delay in samples
+
+  // doa_samples/_meters specifies how much signal1 is later than signal2
+  result.doa_samples = result.delay2 - result.ref_delay + ref_signal_diff_samples;
+  result.doa_meters = (result.doa_samples / layout.sample_rate) * SPEED_OF_LIGHT;
+  result.reliability = std::min({result.reliability3, result.reliability2, result.reliability1});
+}
+
+std::span<const std::complex<float>> Tdoa2::filter_slice(std::span<const std::complex<float>> slice, int bandwidth_khz,
+                                                         std::vector<std::complex<float>> &storage)
+{
+  if (bandwidth_khz == 0)
+  {
+    std::cout << "Signal not filtered" << std::endl;
+    return slice;
+  }
+  if (filter_iq(slice, storage, bandwidth_khz, config_.report))
+  {
+    std::cout << "no filtering performed!" << std::endl;
+    return slice;
+  }
+  return storage;
+}
+
+int Tdoa2::run(std::span<const std::complex<float>> signal1, std::span<const std::complex<float>> signal2,
+               double rx_distance_diff, double rx_distance, Tdoa2Result &result)
+{
+  const SliceLayout &layout = config_.layout;
+  const size_t len = layout.samples_per_slice;
+
+  // integrity checks
+  if (signal1.size() != layout.total())
+  {
+    std::cerr << "Error: Length of Signal 1 is unequal " << layout.total() << std::endl;
+    return 1;
+  }
+  if (signal2.size() != layout.total())
+  {
+    std::cerr << "Error: Length of Signal 2 is unequal " << layout.total() << std::endl;
+    return 1;
+  }
+  if (len < 2 || layout.slice_start(2) + len > layout.total())
+  {
+    std::cerr << "Error: slices do not fit into the capture!" << std::endl;
+    return 1;
+  }
+
+  // slice signal into three parts (views, no copies)
+  auto slice = [&](std::span<const std::complex<float>> signal, int k)
+  {
+    return signal.subspan(layout.slice_start(k), len);
+  };
+
+  // filter measurement to signal bandwidth (DRIFT_RESAMPLE: signal2 after its resampling, the matched
+  // filter takes the unfiltered slices)
+  const bool matched = config_.measure_template != nullptr;
+  const bool resample = !matched && config_.drift_compensation == DRIFT_RESAMPLE;
+  std::cout << "Filter measurement signal to actual bandwidth" << std::endl;
+  auto signal12 = matched ? slice(signal1, 1) : filter_slice(slice(signal1, 1), config_.signal_bandwidth_khz, filtered_[1]);
+  auto signal22 = matched || resample ? slice(signal2, 1)
+                                      : filter_slice(slice(signal2, 1), config_.signal_bandwidth_khz, filtered_[4]);
+
+  // filter ref signal
+  auto signal11 = filter_slice(slice(signal1, 0), config_.ref_bandwidth_khz, filtered_[0]);
+  auto signal13 = filter_slice(slice(signal1, 2), config_.ref_bandwidth_khz, filtered_[2]);
+  auto signal21 = filter_slice(slice(signal2, 0), config_.ref_bandwidth_khz, filtered_[3]);
+  auto signal23 = filter_slice(slice(signal2, 2), config_.ref_bandwidth_khz, filtered_[5]);
+  std::cout << std::endl;
+
+  PreparedIQ p11, p12, p13, p21, p22, p23;
+  if (prepare_iq(signal11.data(), len, config_.corr_type, p11) ||
+      (!matched && prepare_iq(signal12.data(), len, config_.corr_type, p12)) ||
+      prepare_iq(signal13.data(), len, config_.corr_type, p13) || prepare_iq(signal21.data(), len, config_.corr_type, p21) ||
+      (!matched && !resample && prepare_iq(signal22.data(), len, config_.corr_type, p22)) ||
+      prepare_iq(signal23.data(), len, config_.corr_type, p23))
+    return 1;
+
+  const long n = static_cast<long>(len);
+  const bool interp = config_.interpol > 1;
+  auto report = [&](const CorrStats &stats, const char *area)
+  {
+    // formatted apart, the precision of std::cout stays as it is for the result lines
+    std::ostringstream line;
+    line << std::setprecision(3)
+         << (config_.corr_type == CORR_ABS ? "abs cross-correlation" : "dphase cross-correlation") << area
+         << (config_.corr_type == CORR_ABS ? ": max (peak) " : ", max (peak) ") << stats.peak
+         << ", autocorr1 max " << stats.ref1 << ", autocorr2 max " << stats.ref2 << ", => "
+         << std::setprecision(5) << stats.peak_percent << "%";
+    std::cout << line.str() << std::endl;
+  };
+
+  // correlation for slice 1 (ref)
+  std::cout << "CORRELATION CALCULATION DETAILS:" << std::endl;
+  RefCorr ref1;
+  double delay1_native, delay1_interp;
+  if (tdoa2_ref_corr(p11, p21, config_, ref1, slice(signal1, 0), slice(signal2, 0)) ||
+      tdoa2_peak_delay(ref1.corr, ref1.idx, ref1.idx_offset, n, config_.interpol, delay1_native, delay1_interp))
+    return 1;
+  report(ref1.stats, "");
+
+  // correlation for slice 3 (ref check), reported after the measurement
+  RefCorr ref3;
+  double delay3_native, delay3_interp;
+  if (tdoa2_ref_corr(p13, p23, config_, ref3, slice(signal1, 2), slice(signal2, 2)) ||
+      tdoa2_peak_delay(ref3.corr, ref3.idx, ref3.idx_offset, n, config_.interpol, delay3_native, delay3_interp))
+    return 1;
+
+  // DRIFT_RESAMPLE: the drift model of both references resamples the measurement slice of signal2
+  if (resample)
+  {
+    DriftModel model;
+    drift_model(interp ? delay1_interp : delay1_native, ref1.reliability, interp ? delay3_interp : delay3_native,
+                ref3.reliability, layout, config_.max_drift_ppm, model);
+    if (tdoa2_resample_measure(slice(signal2, 1), config_, model, p22))
+      return 1;
+  }
+
+  double delay2_native, delay2_interp, reliability2;
+  if (matched)
+  {
+    // slice 2 (measure): arrival of the template in both signals
+    PeakFit fit = interp ? PEAK_FIT_FFT_UPSAMPLE : PEAK_FIT_NONE;
+    Arrival arrival1, arrival2;
+    double delay;
+    if (matched_filter_delay(slice(signal1, 1), slice(signal2, 1), *config_.measure_template, fit, delay, arrival1,
+                             arrival2, config_.interpol))
+      return 1;
+    tdoa2_arrival_delay(arrival1, arrival2, config_, delay2_native, delay2_interp, reliability2);
+    std::ostringstream line;
+    line << std::setprecision(8) << "matched filter: template at " << arrival1.position << " (signal1), "
+         << arrival2.position << " (signal2)";
+    std::cout << line.str() << std::endl;
+  }
+  else
+  {
+    // correlation for slice 2 (measure), only in the valid area around the ref peak
+    ValidWindow valid = tdoa2_valid_window(ref1.idx_offset + ref1.idx, n, rx_distance_diff, rx_distance, layout.sample_rate);
+    long half_span = config_.smoothing_factor > 0 ? (config_.smoothing_factor - 1) / 2 : 0;
+    LagWindow raw;
+    MeasureCorr measure;
+    if (tdoa2_measure_raw(p12, p22, valid, half_span, config_.corr_segment_len, raw) ||
+        tdoa2_measure_corr(raw, n, valid, config_.smoothing_factor, measure) ||
+        tdoa2_peak_delay(measure.corr, measure.idx, valid.lo, n, config_.interpol, delay2_native, delay2_interp))
+      return 1;
+    reliability2 = measure.reliability;
+    CorrStats stats2 = {raw.peak, p12.energy, p22.energy, 100.0 * 2.0 * raw.peak / (p12.energy + p22.energy)};
+    report(stats2, " (valid area)");
+  }
+  report(ref3.stats, "");
+
+  // calculate correlation results
+  result.delay1 = interp ? delay1_interp : delay1_native;
+  result.delay2 = interp ? delay2_interp : delay2_native;
+  result.delay3 = interp ? delay3_interp : delay3_native;
+  result.reliability1 = ref1.reliability;
+  result.reliability2 = reliability2;
+  result.reliability3 = ref3.reliability;
+  tdoa2_combine(config_, rx_distance_diff, result);
+  double ref_signal_diff_samples = (rx_distance_diff / SPEED_OF_LIGHT) * layout.sample_rate;
+
+  std::cout << std::endl << "CORRELATION RESULTS" << std::endl;
+  std::cout << "raw delay1 (ref) (nativ/interp): " << delay1_native << " / " << delay1_interp
+            << ", reliability nativ (0..1): " << result.reliability1 << std::endl;
+  std::cout << "raw delay2 (measure) (nativ/interp): " << delay2_native << " / " << delay2_interp
+            << ", reliability nativ: " << result.reliability2 << std::endl;
+  std::cout << "raw delay3 (ref check) (nativ/interp): " << delay3_native << " / " << delay3_interp
+            << ", reliability nativ: " << result.reliability3 << std::endl;
+  std::cout << "merged delay of ref and ref check: " << result.ref_delay << std::endl;
+  std::cout << "estimated clock drift between receivers: " << result.drift_ppm << " ppm" << std::endl << std::endl;
+
+  std::cout << "specified distance difference to ref tx [m]: " << std::lround(rx_distance_diff) << std::endl;
+  std::cout << "specified distance difference to ref tx [samples]: " << ref_signal_diff_samples << std::endl;
+  std::cout << "specified distance between two RXes [m]: " << rx_distance << std::endl << std::endl;
+
+  std::cout << "FINAL RESULT" << std::endl;
+  std::cout << "TDOA in samples: " << result.doa_samples << "(how much is signal1 later than signal2)" << std::endl;
+  std::cout << "TDOA in distance [m]: " << result.doa_meters << std::endl;
+  std::cout << "Total Reliability (min of all 3): " << result.reliability << std::endl << std::endl;
+  return 0;
+}
@@ -0,0 +1,177 @@
+#ifndef TDOA2_H
+#define TDOA2_H
+
+#include <vector>
+#include <complex>
+#include <span>
+#include "CorrelateIQ.h"
+#include "CoarseFine.h"
+#include "LagPrior.h"
+#include "ClockDrift.h"
+#include "MatchedFilter.h"
+#include "SliceLayout.h"
+
+// search of the reference correlations
+enum CorrMode
+{
+  CORR_MODE_FULL,       // full correlation (or the welch average, corr_segment_len)
+  CORR_MODE_COARSE_FINE, // xcorr_coarse_fine: decimated full correlation, full rate lag window around its peak
+  CORR_MODE_DAB          // dab_timing: frame timing of a DAB reference, full correlation if none is detected
+};
+
+// clock drift between the receivers (ClockDrift.h)
+enum DriftCompensation
+{
+  DRIFT_OFF,       // tdoa2.m: average of both reference delays
+  DRIFT_REF_DELAY, // reference delay from the linear drift model at the centre of the measurement slice
+  DRIFT_RESAMPLE   // as DRIFT_REF_DELAY, and the measurement slice of signal2 is resampled to the clock of signal1
+};
+
+// parameters of tdoa2.m
+struct Tdoa2Config
+{
+  int smoothing_factor = 0;     // for wideband signals
+  CorrType corr_type = CORR_DPHASE;
+  int signal_bandwidth_khz = 0; // FIR filter of the measurement slice (400, 200, 40, 12, 0)
+  int ref_bandwidth_khz = 0;    // FIR filter of the reference slices
+  int smoothing_factor_ref = 0;
+  int interpol = 0;             // interpolation factor (0 or 1 = no interpolation)
+  size_t corr_segment_len = 0;  // 0: full correlations, > 0: welch average over segments of this length
+  CorrMode corr_mode = CORR_MODE_FULL;
+  SliceLayout layout;
+  DriftCompensation drift_compensation = DRIFT_OFF;
+  TemplateCache *measure_template = nullptr; // not owned, set: matched filter measurement (template_file)
+  double max_drift_ppm = 2.0 / 2.6; // beyond this the references disagree, default matches the 2 sample check
+  bool report = true;               // progress lines of the filters (warnings are always printed)
+};
+
+struct Tdoa2Result
+{
+  double doa_meters;  // delay in meters (how much signal1 is later than signal 2)
+  double doa_samples; // delay in samples
+  double reliability; // min of the three correlation reliabilities, 0(bad)..1(good)
+
+  double delay1, delay2, delay3;                   // raw delays of ref, measure, ref check
+  double reliability1, reliability2, reliability3;
+  double ref_delay;                                // merged reference delay for the measurement slice
+  double drift_ppm;                                // clock drift implied by the two reference delays
+};
+
+// stages of tdoa2.m, used by Tdoa2::run and by the parameter sweep (which shares them between configs)
+// none of them prints, except the reference warnings of tdoa2_combine and (with report) the note of a
+// coarse-fine or DAB fallback
+
+// correlation of a reference slice pair (correlate_iq.m), its reliability and peak
+struct RefCorr
+{
+  std::vector<double> corr; // normalized (smoothed) correlation, corr[i] at correlation index idx_offset + i
+  CorrStats stats;
+  size_t idx;               // first maximum
+  double reliability;       // corr_reliability of corr, for a coarse-fine or DAB window at most the reliability
+                            // of the coarse correlation: the window misses the far sidelobes that the
+                            // full correlation sees, the coarse correlation covers all lags
+  long idx_offset = 0;      // 0 for the full correlation (lag 0 at index n-1), > 0 for a lag window
+};
+
+// true if the references are full correlations, false if tdoa2_ref_corr only returns a lag window
+bool tdoa2_full_ref(const Tdoa2Config &config);
+
+// reference correlation with the corr_type, smoothing_factor_ref and correlation of config:
+// the full correlation, the welch average of corr_segment_len segments (lags +-(corr_segment_len - 1))
+// or the lag window of the coarse-fine / DAB search (the full correlation if it falls back),
+// the peak refers to the returned lags, the reliability see RefCorr
+// iq_a, iq_b: the unfiltered slices of a and b, only needed for CORR_MODE_DAB
+// single threaded, the callers run pairs and sweep points concurrently
+int tdoa2_ref_corr(const PreparedIQ &a, const PreparedIQ &b, const Tdoa2Config &config, RefCorr &ref,
+                   std::span<const std::complex<float>> iq_a = {}, std::span<const std::complex<float>> iq_b = {});
+
+// delay of the maximum corr[idx] (>0: signal1 later), idx_offset: correlation index of corr[0],
+// n: slice length, delay_interp: fft upsampled delay for interpol > 1, otherwise 0
+int tdoa2_peak_delay(const std::vector<double> &corr, size_t idx, long idx_offset, long n, int interpol,
+                     double &delay_native, double &delay_interp);
+
+// valid correlation area around the reference peak idx1, such that: toa < distance of the two RXes
+// lo, hi: correlation indices (inclusive)
+struct ValidWindow
+{
+  long lo;
+  long hi;
+};
+ValidWindow tdoa2_valid_window(size_t idx1, long n, double rx_distance_diff, double rx_distance, double sample_rate);
+
+// raw measurement correlation over the valid area plus 'margin' lags on both sides (e.g. half the
+// largest smoothing span), lag_lo of raw is the correlation index minus n-1
+// segment_len > 0: window of the welch average (corr_segment_len), the valid area must lie within its lags
+int tdoa2_measure_raw(const PreparedIQ &a, const PreparedIQ &b, const ValidWindow &valid, long margin,
+                      size_t segment_len, LagWindow &raw);
+
+// measurement lag expected from a prior of the TDOA (doa_samples of an earlier result, signal1 later than
+// signal2), ref_idx: correlation index of the reference peak (inverse of tdoa2_combine without drift)
+LagPrior tdoa2_lag_prior(const LagPrior &doa_prior, size_t ref_idx, long n, double rx_distance_diff, double sample_rate);
+
+// measurement correlation only around a lag prior instead of the whole valid area: xcorr_prior within the
+// valid area (widened while unreliable), searched: correlation indices of the searched lags (take the place
+// of the valid area in tdoa2_measure_corr and tdoa2_peak_delay), raw as tdoa2_measure_raw for searched
+// report = false skips the notes of the widenings
+int tdoa2_measure_prior(const LagCorrelator &correlate, long n, const ValidWindow &valid, const LagPrior &lag_prior,
+                        long margin, bool report, LagWindow &raw, ValidWindow &searched);
+
+// smoothing of the raw window, normalization to the valid area, reliability and peak
+// the margin of raw must cover half the smoothing span (or reach the ends of the correlation)
+struct MeasureCorr
+{
+  std::vector<double> corr; // valid area only, corr[0] belongs to valid.lo
+  size_t idx;
+  double reliability;
+};
+int tdoa2_measure_corr(const LagWindow &raw, long n, const ValidWindow &valid, int smoothing_factor, MeasureCorr &measure);
+
+// DRIFT_RESAMPLE: the unfiltered measurement slice of signal2 resampled by 1 / drift_ratio(model) from its
+// first sample, so its delay to signal1 stays at the one of that sample, then filtered and abs/dphase as
+// the other slices; the samples the resampler cannot interpolate at the end are zero
+int tdoa2_resample_measure(std::span<const std::complex<float>> iq2, const Tdoa2Config &config, const DriftModel &model,
+                           PreparedIQ &prepared);
+
+// matched filter measurement (measure_template): arrival of the template in the unfiltered measurement
+// slice iq over all positions, fitted by FFT upsampling with interpol > 1 (as tdoa2_peak_delay)
+int tdoa2_measure_arrival(std::span<const std::complex<float>> iq, const Tdoa2Config &config, Arrival &arrival);
+
+// delay2 of the arrivals of both receivers (>0: signal1 later), native: integer positions, interp: fitted
+// positions with interpol > 1 (otherwise 0), reliability: the lower corr_reliability of both filter outputs
+void tdoa2_arrival_delay(const Arrival &arrival1, const Arrival &arrival2, const Tdoa2Config &config,
+                         double &delay_native, double &delay_interp, double &reliability);
+
+// merge of the reference delays and the final TDOA from result.delay1..3 and reliability1..3
+// (DRIFT_RESAMPLE: delay2 is compared with the model delay at the first sample of the measurement slice)
+void tdoa2_combine(const Tdoa2Config &config, double rx_distance_diff, Tdoa2Result &result);
+
+// tdoa2.m: TDOA of two signals captured by two RXs
+// the slices are views into the capture buffers, only filtered slices get their own storage
+// the measurement correlation is only computed in the valid window around the reference peak
+// (tdoa2.m computes it fully and masks it, maximum and reliability are the same)
+// interpol > 1 replaces interp() + re-correlation by fft upsampling of the correlation peak
+// with measure_template the measurement is the difference of the template arrivals in both slices
+class Tdoa2
+{
+public:
+  explicit Tdoa2(const Tdoa2Config &config) : config_(config) {}
+
+  const Tdoa2Config &config() const { return config_; }
+  // new parameters for the next run, the filtered slice buffers are kept
+  void set_config(const Tdoa2Config &config) { config_ = config; }
+
+  // rx_distance_diff: difference in distance in meters between two RX to Ref (sign matters)
+  // rx_distance: distance between RX1 and RX2 in meters (always positive)
+  int run(std::span<const std::complex<float>> signal1, std::span<const std::complex<float>> signal2,
+          double rx_distance_diff, double rx_distance, Tdoa2Result &result);
+
+private:
+  // filtered view of a slice, the slice itself if bandwidth_khz is 0
+  std::span<const std::complex<float>> filter_slice(std::span<const std::complex<float>> slice, int bandwidth_khz,
+                                                    std::vector<std::complex<float>> &storage);
+
+  Tdoa2Config config_;
+  std::vector<std::complex<float>> filtered_[6]; // storage of filtered slices, reused between runs
+};
+
+#endif
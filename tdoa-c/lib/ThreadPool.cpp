@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <string>
+#include <algorithm>
+
+namespace
+{
+  thread_local const ThreadPool *current_pool = nullptr;
+  thread_local int current_index = -1;
+}
+
+ThreadPool::ThreadPool(unsigned num_threads)
+{
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < num_threads; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+  for (unsigned i = 0; i < num_threads; ++i)
+    threads_.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread &t : threads_)
+    t.join();
+}
+
+int ThreadPool::worker_index() const
+{
+  return current_pool == this ? current_index : -1;
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+  int self = worker_index();
+  unsigned index = self >= 0 ? static_cast<unsigned>(self) : next_queue_++ % size();
+  {
+    std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard<std::mutex> lock(wait_mutex_);
+    ++queued_;
+  }
+  wake_.notify_one();
+}
+
+bool ThreadPool::try_pop(unsigned index, std::function<void()> &task)
+{
+  // own deque from the back, then steal from the front of the others
+  for (unsigned k = 0; k < size(); ++k)
+  {
+    Queue &q = *queues_[(index + k) % size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty())
+      continue;
+    if (k == 0)
+    {
+      task = std::move(q.tasks.back());
+      q.tasks.pop_back();
+    }
+    else
+    {
+      task = std::move(q.tasks.front());
+      q.tasks.pop_front();
+    }
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::worker(unsigned index)
+{
+  current_pool = this;
+  current_index = static_cast<int>(index);
+  trace_thread_name("worker " + std::to_string(index));
+  std::function<void()> task;
+  while (true)
+  {
+    if (try_pop(index, task))
+    {
+      {
+        std::lock_guard<std::mutex> lock(wait_mutex_);
+        --queued_;
+      }
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(wait_mutex_);
+    wake_.wait(lock, [this]() { return stop_ || queued_ > 0; });
+    if (stop_ && queued_ == 0)
+      return;
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// work-stealing thread pool: every worker has its own deque, tasks submitted from a worker go to
+// its own deque and are taken LIFO (warm caches), idle workers steal FIFO from the others
+// tasks from outside the pool are spread round robin, idle workers sleep on a condition variable
+// one lock per deque operation, a few microseconds per task
+class ThreadPool
+{
+public:
+  explicit ThreadPool(unsigned num_threads = 0); // 0: all cores
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  unsigned size() const { return static_cast<unsigned>(threads_.size()); }
+
+  void submit(std::function<void()> task);
+
+  // index of the calling worker of this pool, -1 for other threads
+  int worker_index() const;
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void worker(unsigned index);
+  bool try_pop(unsigned index, std::function<void()> &task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex wait_mutex_;
+  std::condition_variable wake_;
+  size_t queued_ = 0; // submitted and not yet taken, guarded by wait_mutex_
+  bool stop_ = false;
+  std::atomic<unsigned> next_queue_{0};
+};
+
+#endif
@@ -0,0 +1,166 @@
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+#include <cstdint>
+
+namespace trace_detail
+{
+  std::atomic<bool> enabled{false};
+}
+
+namespace
+{
+  const size_t RING_EVENTS = 16384; // per thread, 80 bytes each
+
+  struct Event
+  {
+    char name[48];
+    char category[16];
+    int64_t start_ns; // since the trace epoch
+    int64_t duration_ns;
+  };
+
+  // ring buffer of one thread, the mutex is only contended while trace_write runs
+  struct ThreadBuffer
+  {
+    std::mutex mutex;
+    std::vector<Event> events;
+    size_t next = 0;  // slot of the next event
+    size_t count = 0; // valid events (<= RING_EVENTS)
+    bool wrapped = false; // old events were overwritten
+    int tid;
+    std::string name;
+  };
+
+  std::mutex registry_mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> registry; // buffers outlive their threads
+  std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+  thread_local std::shared_ptr<ThreadBuffer> local_buffer;
+  thread_local std::string local_name;
+
+  ThreadBuffer &thread_buffer()
+  {
+    if (!local_buffer)
+    {
+      auto buffer = std::make_shared<ThreadBuffer>();
+      buffer->events.resize(RING_EVENTS);
+      std::lock_guard<std::mutex> lock(registry_mutex);
+      buffer->tid = static_cast<int>(registry.size()) + 1;
+      buffer->name = local_name.empty() ? "thread " + std::to_string(buffer->tid) : local_name;
+      registry.push_back(buffer);
+      local_buffer = buffer;
+    }
+    return *local_buffer;
+  }
+
+  void copy_text(char *dest, size_t size, const char *src)
+  {
+    size_t len = std::min(std::strlen(src), size - 1);
+    std::memcpy(dest, src, len);
+    dest[len] = '\0';
+  }
+
+  // names are plain identifiers in this code base, only quotes and backslashes are escaped
+  void write_json_string(std::ostream &out, const std::string &s)
+  {
+    out << '"';
+    for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        out << '\\';
+      out << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+    }
+    out << '"';
+  }
+}
+
+void trace_enable(bool on)
+{
+  trace_detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void trace_thread_name(const std::string &name)
+{
+  local_name = name;
+  if (local_buffer)
+  {
+    std::lock_guard<std::mutex> lock(local_buffer->mutex);
+    local_buffer->name = name;
+  }
+}
+
+void trace_event(const char *name, const char *category, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point stop)
+{
+  if (!trace_enabled())
+    return;
+  ThreadBuffer &buffer = thread_buffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  Event &e = buffer.events[buffer.next];
+  copy_text(e.name, sizeof(e.name), name);
+  copy_text(e.category, sizeof(e.category), category);
+  e.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count();
+  e.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+  buffer.next = (buffer.next + 1) % RING_EVENTS;
+  buffer.wrapped = buffer.wrapped || buffer.count == RING_EVENTS;
+  buffer.count = std::min(buffer.count + 1, RING_EVENTS);
+}
+
+int trace_write(const std::string &filename)
+{
+  std::ofstream out(filename);
+  if (!out.is_open())
+  {
+    std::cerr << "Error: trace file " << filename << " cannot be written!" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffers = registry;
+  }
+
+  // complete events ("ph":"X") with times in microseconds, one thread_name record per thread
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  size_t dropped = 0;
+  for (const auto &buffer : buffers)
+  {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+        << ",\"args\":{\"name\":";
+    write_json_string(out, buffer->name);
+    out << "}}";
+    first = false;
+    size_t oldest = (buffer->next + RING_EVENTS - buffer->count) % RING_EVENTS;
+    for (size_t i = 0; i < buffer->count; ++i)
+    {
+      const Event &e = buffer->events[(oldest + i) % RING_EVENTS];
+      out << ",\n{\"name\":";
+      write_json_string(out, e.name);
+      out << ",\"cat\":";
+      write_json_string(out, e.category);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << e.start_ns / 1000 << "."
+          << (e.start_ns % 1000) / 100 << ",\"dur\":" << e.duration_ns / 1000 << "." << (e.duration_ns % 1000) / 100
+          << "}";
+    }
+    if (buffer->wrapped)
+      ++dropped;
+  }
+  out << "\n]}" << std::endl;
+  if (dropped)
+    std::cerr << "trace: the ring buffer of " << dropped << " threads was full, their oldest spans are missing" << std::endl;
+  if (!out)
+  {
+    std::cerr << "Error: trace file " << filename << " cannot be written!" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,62 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <atomic>
+#include <chrono>
+
+// per-stage tracing in the chrome trace event format (chrome://tracing, ui.perfetto.dev)
+// always compiled in and off by default: a disabled span costs one relaxed atomic load
+// spans go into a ring buffer of the calling thread (the oldest spans are overwritten when it is
+// full), so tracing never blocks other threads and its memory stays bounded
+
+namespace trace_detail
+{
+  extern std::atomic<bool> enabled;
+}
+
+inline bool trace_enabled()
+{
+  return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+void trace_enable(bool on);
+
+// name of the calling thread in the trace (e.g. "worker 2"), before its first span
+void trace_thread_name(const std::string &name);
+
+// one complete span of the calling thread, name and category are copied (truncated to a few dozen chars)
+void trace_event(const char *name, const char *category, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point stop);
+
+// trace json of all threads, spans still open are not included, returns 1 if the file cannot be written
+int trace_write(const std::string &filename);
+
+// span from construction to the end of the scope, no span if name is nullptr
+class TraceSpan
+{
+public:
+  explicit TraceSpan(const char *name, const char *category = "tdoa")
+      : name_(name), category_(category), active_(name && trace_enabled())
+  {
+    if (active_)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  ~TraceSpan()
+  {
+    if (active_)
+      trace_event(name_, category_, start_, std::chrono::steady_clock::now());
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  const char *name_;
+  const char *category_;
+  bool active_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#endif
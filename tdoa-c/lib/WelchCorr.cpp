@@ -0,0 +1,99 @@
+#include "WelchCorr.h"
+#include "FFT.h"
+#include <iostream>
+#include <complex>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace
+{
+  const size_t SEGMENTS_PER_GROUP = 8; // fixed reduction order, independent of the thread count
+}
+
+int xcorr_welch(const PreparedIQ &a, const PreparedIQ &b, size_t seg_len, size_t overlap,
+                std::vector<double> &corr, double &peak, unsigned num_threads)
+{
+  size_t n = std::min(a.seq.size(), b.seq.size());
+  if (n == 0 || seg_len == 0 || overlap >= seg_len)
+  {
+    std::cerr << "Error: invalid welch segmentation!" << std::endl;
+    return 1;
+  }
+  seg_len = std::min(seg_len, n);
+
+  // segment starts, the last segment is aligned to the end so no samples are dropped
+  size_t step = seg_len - overlap;
+  std::vector<size_t> starts;
+  for (size_t s = 0; s + seg_len <= n; s += step)
+    starts.push_back(s);
+  if (starts.back() + seg_len < n)
+    starts.push_back(n - seg_len);
+
+  size_t len = next_pow2(2 * seg_len);
+  size_t bins = len / 2 + 1;
+  const FFTPlan &plan = get_fft_plan(len);
+
+  size_t groups = (starts.size() + SEGMENTS_PER_GROUP - 1) / SEGMENTS_PER_GROUP;
+  std::vector<std::complex<double>> partial(groups * bins, 0.0);
+
+  std::atomic<size_t> next_group(0);
+  auto worker = [&]()
+  {
+    std::vector<std::complex<double>> z(len);
+    for (size_t g = next_group++; g < groups; g = next_group++)
+    {
+      std::complex<double> *acc = partial.data() + g * bins;
+      size_t seg_end = std::min(starts.size(), (g + 1) * SEGMENTS_PER_GROUP);
+      for (size_t s = g * SEGMENTS_PER_GROUP; s < seg_end; ++s)
+      {
+        const double *x = a.seq.data() + starts[s];
+        const double *y = b.seq.data() + starts[s];
+        for (size_t i = 0; i < seg_len; ++i)
+          z[i] = std::complex<double>(x[i] - a.mean, y[i] - b.mean);
+        std::fill(z.begin() + seg_len, z.end(), 0.0);
+        plan.forward(z);
+
+        for (size_t k = 0; k < bins; ++k)
+        {
+          size_t kn = (len - k) & (len - 1);
+          std::complex<double> zk = z[k], zn = std::conj(z[kn]);
+          std::complex<double> xk = 0.5 * (zk + zn);
+          std::complex<double> yk = std::complex<double>(0.0, -0.5) * (zk - zn);
+          acc[k] += xk * std::conj(yk);
+        }
+      }
+    }
+  };
+
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = static_cast<unsigned>(std::min<size_t>(num_threads, groups));
+  std::vector<std::thread> threads;
+  for (unsigned t = 1; t < num_threads; ++t)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+
+  // deterministic reduction in group order, then hermitian extension and one ifft
+  std::vector<std::complex<double>> z(len, 0.0);
+  for (size_t g = 0; g < groups; ++g)
+    for (size_t k = 0; k < bins; ++k)
+      z[k] += partial[g * bins + k];
+  for (size_t k = 1; k < bins - 1; ++k)
+    z[len - k] = std::conj(z[k]);
+  z[bins - 1] = z[bins - 1].real();
+  plan.inverse(z);
+
+  corr.resize(2 * seg_len - 1);
+  peak = -std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < corr.size(); ++i)
+  {
+    size_t k = (i + len - (seg_len - 1)) & (len - 1);
+    corr[i] = z[k].real();
+    peak = std::max(peak, corr[i]);
+  }
+  return 0;
+}
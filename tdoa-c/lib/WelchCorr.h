@@ -0,0 +1,17 @@
+#ifndef WELCH_CORR_H
+#define WELCH_CORR_H
+
+#include <vector>
+#include <cstddef>
+#include "CorrelateIQ.h"
+
+// Welch-style cross-correlation: the slice is split into overlapping segments of seg_len samples,
+// each segment pair is zero padded to 2*seg_len and transformed, the cross spectra are averaged
+// and one inverse fft gives the correlation for lags -(seg_len-1) .. seg_len-1 (lag 0 at index seg_len-1)
+// seg_len must be well above the largest expected delay
+// segments are summed in fixed groups and the groups are reduced in order, so the result does
+// not depend on num_threads (0: all cores)
+int xcorr_welch(const PreparedIQ &a, const PreparedIQ &b, size_t seg_len, size_t overlap,
+                std::vector<double> &corr, double &peak, unsigned num_threads = 0);
+
+#endif
@@ -0,0 +1,223 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include "../lib/Config.h"
+#include "../lib/Capture.h"
+#include "../lib/Trace.h"
+
+// tdoa-batch: reprocessing of a whole recording directory (or a catalog of capture ids)
+// every capture is a task graph on one shared pool, several captures are in flight at the same time,
+// so the reads of the next captures overlap the correlations of the current ones
+// one csv record per capture, throughput and stage utilization at the end
+// with memory_budget_mb the captures run one after the other within the budget (BudgetPairs.h)
+
+// memory_budget_mb > 0: one capture after the other on this thread with the budgeted engine
+// (no pool, no result cache), the budget is shared by all captures
+static int run_budgeted(const TdoaConfig &config, const std::vector<std::string> &ids, std::ostream &out)
+{
+  MemoryBudget budget(config.memory_budget_mb * 1024 * 1024);
+  BudgetPlan plan = {};
+  Capture capture;
+  size_t num_ok = 0, num_failed = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string &id : ids)
+  {
+    capture.id = id;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = capture_run_budgeted(config, capture, false, budget, plan) == 0;
+    trace_event(("capture " + capture.id).c_str(), "capture", t0, std::chrono::steady_clock::now());
+    ok ? ++num_ok : ++num_failed;
+    capture_write_record(out, capture, ok);
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cerr << std::endl << "processed " << num_ok + num_failed << " captures (" << num_failed << " failed) in "
+            << wall_s << " s within a memory budget of " << config.memory_budget_mb << " MB ("
+            << (plan.strategy == BUDGET_RESIDENT ? "resident" : "streamed") << ", tracked peak "
+            << budget.peak() / 1024 << " KB)" << std::endl;
+  std::cerr << "throughput: " << (wall_s > 0.0 ? static_cast<double>(num_ok + num_failed) / wall_s : 0.0)
+            << " captures/s" << std::endl;
+  if (!config.trace_file.empty() && trace_write(config.trace_file) == 0)
+    std::cerr << "trace written to " << config.trace_file << std::endl;
+  return num_failed ? 1 : 0;
+}
+
+// ids with a file <k>_<id> for every receiver k = 1..num_rx
+static int scan_directory(const std::string &dir, size_t num_rx, std::vector<std::string> &ids)
+{
+  std::error_code ec;
+  std::map<std::string, std::set<size_t>> found;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, ec))
+  {
+    if (!entry.is_regular_file())
+      continue;
+    size_t rx;
+    std::string id;
+    if (parse_rx_file_name(entry.path().filename().string(), rx, id) && rx >= 1 && rx <= num_rx)
+      found[id].insert(rx);
+  }
+  if (ec)
+  {
+    std::cerr << "Error: directory " << dir << " cannot be read: " << ec.message() << std::endl;
+    return 1;
+  }
+
+  size_t incomplete = 0;
+  for (const auto &f : found)
+    if (f.second.size() == num_rx)
+      ids.push_back(f.first);
+    else
+      ++incomplete;
+  if (incomplete)
+    std::cout << "skipping " << incomplete << " incomplete receiver sets" << std::endl;
+  return 0;
+}
+
+// one capture id per line, '#' and '%' start comments
+static int read_catalog(const std::string &filename, std::vector<std::string> &ids)
+{
+  std::ifstream file(filename);
+  if (!file.is_open())
+  {
+    std::cerr << "Error: catalog " << filename << " cannot be opened!" << std::endl;
+    return 1;
+  }
+  std::string line;
+  while (std::getline(file, line))
+  {
+    line = line.substr(0, line.find_first_of("#%"));
+    size_t b = line.find_first_not_of(" \t\r"), e = line.find_last_not_of(" \t\r");
+    if (b != std::string::npos)
+      ids.push_back(line.substr(b, e - b + 1));
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3 || argc > 5)
+  {
+    std::cerr << "usage: " << argv[0] << " <config.ini | config.m> <directory | @catalog> [results.csv] [captures_in_flight]" << std::endl;
+    std::cerr << "       directory: every complete set <rx>_<id> is processed, catalog: one id per line" << std::endl;
+    std::cerr << "       (files in folder_identifier of the config)" << std::endl;
+    return 1;
+  }
+
+  TdoaConfig config;
+  if (load_config(argv[1], config))
+    return 1;
+  if (config.rx.size() < 2)
+  {
+    std::cerr << "Error: at least two receivers are needed!" << std::endl;
+    return 1;
+  }
+
+  std::string source = argv[2];
+  std::vector<std::string> ids;
+  if (source[0] == '@')
+  {
+    if (read_catalog(source.substr(1), ids))
+      return 1;
+  }
+  else
+  {
+    config.folder_identifier = source.back() == '/' ? source : source + "/";
+    if (scan_directory(source, config.rx.size(), ids))
+      return 1;
+  }
+  std::cout << ids.size() << " captures to process" << std::endl;
+
+  std::ofstream out_file;
+  if (argc >= 4)
+  {
+    out_file.open(argv[3]);
+    if (!out_file.is_open())
+    {
+      std::cerr << "Error: " << argv[3] << " cannot be written!" << std::endl;
+      return 1;
+    }
+  }
+  std::ostream &out = argc >= 4 ? out_file : std::cout;
+  size_t in_flight = argc == 5 ? static_cast<size_t>(std::max(1, std::atoi(argv[4]))) : 2;
+
+  std::vector<RxPairJob> pair_list;
+  if (capture_pair_jobs(config, pair_list))
+    return 1;
+  capture_write_header(out, pair_list);
+
+  trace_enable(!config.trace_file.empty());
+  if (config.memory_budget_mb > 0)
+    return run_budgeted(config, ids, out);
+
+  ResultCache cache;
+  if (!config.cache_dir.empty() && cache.open(config.cache_dir))
+    return 1;
+
+  ThreadPool pool;
+  std::mutex mutex; // output and statistics
+  std::map<std::string, double> stage_busy_ms;
+  std::map<std::string, size_t> stage_tasks;
+  size_t num_ok = 0, num_failed = 0;
+  std::atomic<size_t> next{0};
+
+  // each driver keeps one capture in flight on the shared pool, its buffers are reused for the next one
+  auto driver = [&]()
+  {
+    Capture capture;
+    trace_thread_name("driver");
+    for (size_t i = next++; i < ids.size(); i = next++)
+    {
+      capture.id = ids[i];
+      TaskGraph graph;
+      TaskGraph::TaskId last;
+      auto t0 = std::chrono::steady_clock::now();
+      bool ok = capture_tasks(graph, config, capture, false, last, cache.is_open() ? &cache : nullptr) == 0 && graph.run(pool) == 0;
+      trace_event(("capture " + capture.id).c_str(), "capture", t0, std::chrono::steady_clock::now());
+
+      std::lock_guard<std::mutex> lock(mutex);
+      for (const TaskTiming &t : graph.timings())
+        if (t.worker >= 0)
+        {
+          stage_busy_ms[t.stage] += t.duration_ms;
+          ++stage_tasks[t.stage];
+        }
+      ok ? ++num_ok : ++num_failed;
+
+      capture_write_record(out, capture, ok);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> drivers;
+  for (size_t d = 1; d < std::min(in_flight, ids.size()); ++d)
+    drivers.emplace_back(driver);
+  driver();
+  for (std::thread &t : drivers)
+    t.join();
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cerr << std::endl << "processed " << num_ok + num_failed << " captures (" << num_failed << " failed) in "
+            << wall_s << " s with " << pool.size() << " threads, " << in_flight << " captures in flight" << std::endl;
+  std::cerr << "throughput: " << (wall_s > 0.0 ? static_cast<double>(num_ok + num_failed) / wall_s : 0.0)
+            << " captures/s" << std::endl;
+  if (!config.trace_file.empty() && trace_write(config.trace_file) == 0)
+    std::cerr << "trace written to " << config.trace_file << std::endl;
+  if (cache.is_open())
+    std::cerr << "result cache: " << cache.hits() << " hits, " << cache.misses() << " misses" << std::endl;
+  std::cerr << "stage       tasks  busy_s    utilization" << std::endl;
+  for (const auto &s : stage_busy_ms)
+    std::cerr << std::left << std::setw(12) << s.first << std::right << std::setw(5) << stage_tasks[s.first]
+              << std::fixed << std::setprecision(2) << std::setw(8) << s.second / 1000.0 << std::setw(10)
+              << 100.0 * s.second / 1000.0 / (wall_s * pool.size()) << "%" << std::defaultfloat << std::endl;
+  return num_failed ? 1 : 0;
+}
@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <complex>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include "../lib/CorrelateIQ.h"
+#include "../lib/WelchCorr.h"
+
+// accuracy against run time of the welch segment length on synthetic slices:
+// common noise-like signal, rx2 delayed by a known number of samples, independent noise per rx
+
+static long argmax_lag(const std::vector<double> &corr, size_t zero_idx)
+{
+  size_t idx = 0;
+  for (size_t i = 1; i < corr.size(); ++i)
+    if (corr[i] > corr[idx])
+      idx = i;
+  return static_cast<long>(idx) - static_cast<long>(zero_idx);
+}
+
+int main()
+{
+  const size_t num_samples = 1000000;
+  const long true_delay = 321; // signal1 later than signal2
+  const int trials = 4;
+  const std::vector<double> snr_db = {0.0, -6.0, -10.0};
+  const std::vector<size_t> seg_lens = {0, 4096, 16384, 65536}; // 0: full correlation
+
+  std::mt19937 gen(2017);
+  std::normal_distribution<float> noise;
+
+  std::cout << "snr_db  seg_len  correct  mean_abs_err  time_ms" << std::endl;
+  for (double snr : snr_db)
+  {
+    float noise_amp = static_cast<float>(std::pow(10.0, -snr / 20.0));
+    std::vector<std::vector<PreparedIQ>> prepared(trials, std::vector<PreparedIQ>(2));
+    for (int t = 0; t < trials; ++t)
+    {
+      std::vector<std::complex<float>> source(num_samples + true_delay);
+      for (auto &v : source)
+        v = std::complex<float>(noise(gen), noise(gen));
+      std::vector<std::complex<float>> rx1(num_samples), rx2(num_samples);
+      for (size_t i = 0; i < num_samples; ++i)
+      {
+        rx1[i] = source[i] + noise_amp * std::complex<float>(noise(gen), noise(gen));
+        rx2[i] = source[i + true_delay] + noise_amp * std::complex<float>(noise(gen), noise(gen));
+      }
+      prepare_iq(rx1, CORR_DPHASE, prepared[t][0]);
+      prepare_iq(rx2, CORR_DPHASE, prepared[t][1]);
+    }
+
+    for (size_t seg_len : seg_lens)
+    {
+      int correct = 0;
+      double abs_err = 0.0, time_ms = 0.0;
+      for (int t = 0; t < trials; ++t)
+      {
+        std::vector<double> corr;
+        double peak;
+        auto start = std::chrono::steady_clock::now();
+        if (seg_len == 0)
+          xcorr_fft(prepared[t][0], prepared[t][1], corr, peak);
+        else
+          xcorr_welch(prepared[t][0], prepared[t][1], seg_len, seg_len / 2, corr, peak);
+        auto stop = std::chrono::steady_clock::now();
+        time_ms += std::chrono::duration<double, std::milli>(stop - start).count();
+
+        size_t zero_idx = (seg_len == 0) ? num_samples - 1 : seg_len - 1;
+        long err = std::labs(argmax_lag(corr, zero_idx) - true_delay);
+        correct += (err == 0);
+        abs_err += static_cast<double>(err);
+      }
+      std::cout << std::setw(6) << snr << "  " << std::setw(7) << seg_len << "  " << std::setw(4) << correct << "/" << trials
+                << "  " << std::setw(12) << abs_err / trials << "  " << std::setw(7) << std::fixed << std::setprecision(1)
+                << time_ms / trials << std::defaultfloat << std::setprecision(6) << std::endl;
+    }
+  }
+  return 0;
+}
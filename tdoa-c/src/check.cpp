@@ -0,0 +1,490 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <complex>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "../lib/CorrReliability.h"
+#include "../lib/FFT.h"
+#include "../lib/Tdoa2.h"
+#include "../lib/Sweep.h"
+#include "../lib/MultiRx.h"
+#include "../lib/Resampler.h"
+#include "../lib/MatchedFilter.h"
+
+// equivalence of the optimized stages with what they replace, on random / synthetic data:
+// - corr_reliability against a literal port of the loop of corr_reliability.m
+// - ifft_window against the full inverse fft
+// - tdoa2_sweep against Tdoa2::run for every grid point (full, coarse-fine and welch correlations)
+// - the coarse-fine and DAB reference correlations against the full one
+// - Tdoa2::run with the coarse-fine and DAB references against the full ones
+// - the resampled measurement (drift_compensation = resample) of tdoa2_pairs against Tdoa2::run
+// - the matched filter measurement (template_file) of tdoa2_pairs against Tdoa2::run
+// returns 1 if any comparison fails
+
+// corr_reliability.m line by line (first maximum as max() of matlab)
+static double corr_reliability_matlab(const std::vector<double> &correlation)
+{
+  size_t idx = std::max_element(correlation.begin(), correlation.end()) - correlation.begin();
+  double corr_max = correlation[idx];
+  std::vector<double> correlation_temp = correlation;
+  correlation_temp[idx] = 0;
+
+  double bin_right_old = corr_max;
+  for (size_t ii = idx + 1; ii < correlation.size(); ++ii)
+  {
+    if (correlation_temp[ii] < bin_right_old)
+    {
+      bin_right_old = correlation_temp[ii];
+      correlation_temp[ii] = 0;
+    }
+    else
+      break;
+  }
+
+  double bin_left_old = corr_max;
+  for (size_t ii = idx; ii-- > 0;)
+  {
+    if (correlation_temp[ii] < bin_left_old)
+    {
+      bin_left_old = correlation_temp[ii];
+      correlation_temp[ii] = 0;
+    }
+    else
+      break;
+  }
+
+  double peak2 = *std::max_element(correlation_temp.begin(), correlation_temp.end());
+  return 1 - (peak2 / corr_max);
+}
+
+static int check_reliability(std::mt19937 &gen)
+{
+  std::normal_distribution<double> noise;
+  std::uniform_int_distribution<int> level(-3, 3);
+  int failed = 0, cases = 0;
+  for (size_t n : {1, 2, 3, 10, 257, 4096})
+    for (int shape = 0; shape < 4; ++shape)
+      for (int trial = 0; trial < 50; ++trial)
+      {
+        // noise, correlation like peak on noise, few levels (ties, plateaus), smoothed noise
+        std::vector<double> corr(n);
+        size_t peak = std::uniform_int_distribution<size_t>(0, n - 1)(gen);
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i)
+        {
+          double d = static_cast<double>(i) - static_cast<double>(peak);
+          sum = 0.8 * sum + noise(gen);
+          corr[i] = shape == 0   ? noise(gen)
+                    : shape == 1 ? 10.0 * std::exp(-d * d / 20.0) + 0.3 * noise(gen)
+                    : shape == 2 ? static_cast<double>(level(gen))
+                                 : sum;
+        }
+        double expected = corr_reliability_matlab(corr);
+        double actual = corr_reliability(corr);
+        ++cases;
+        // nan (all zero) must match as well
+        if (!(actual == expected || (std::isnan(actual) && std::isnan(expected))))
+        {
+          if (failed++ < 5)
+            std::cout << "corr_reliability n " << n << " shape " << shape << ": " << actual << " != " << expected << std::endl;
+        }
+      }
+  std::cout << "corr_reliability vs corr_reliability.m: " << cases - failed << "/" << cases << " identical" << std::endl;
+  return failed ? 1 : 0;
+}
+
+static int check_ifft_window(std::mt19937 &gen)
+{
+  std::normal_distribution<double> noise;
+  int failed = 0, cases = 0;
+  for (size_t n : {2, 64, 1024, 65536})
+  {
+    std::vector<std::complex<double>> spec(n), full(n);
+    for (auto &v : spec)
+      v = std::complex<double>(noise(gen), noise(gen));
+    full = spec;
+    get_fft_plan(n).inverse(full);
+    double scale = 0.0;
+    for (const auto &v : full)
+      scale = std::max(scale, std::abs(v));
+
+    for (size_t count : {size_t(1), size_t(3), size_t(17), n / 2, n})
+      for (long first : {0L, -5L, static_cast<long>(n) - 1, static_cast<long>(n / 3), -static_cast<long>(2 * n)})
+      {
+        if (count == 0 || count > n)
+          continue;
+        std::vector<std::complex<double>> out(count);
+        ifft_window(spec.data(), n, first, count, out.data());
+        double err = 0.0;
+        for (size_t j = 0; j < count; ++j)
+        {
+          long k = ((first + static_cast<long>(j)) % static_cast<long>(n) + static_cast<long>(n)) % static_cast<long>(n);
+          err = std::max(err, std::abs(out[j] - full[static_cast<size_t>(k)]));
+        }
+        ++cases;
+        if (err > 1e-9 * scale)
+        {
+          if (failed++ < 5)
+            std::cout << "ifft_window n " << n << " first " << first << " count " << count << ": error " << err << std::endl;
+        }
+      }
+  }
+  std::cout << "ifft_window vs full inverse fft: " << cases - failed << "/" << cases << " within rounding" << std::endl;
+  return failed ? 1 : 0;
+}
+
+static int check_sweep(std::mt19937 &gen)
+{
+  // small captures: a noise-like signal per slice, rx2 earlier by a known delay, independent noise
+  Tdoa2Config base;
+  base.layout.samples_per_freq = 24000;
+  base.layout.samples_per_slice = 20000;
+  base.layout.guard_interval = 4000;
+  base.report = false;
+  const long delay = 7;
+  const size_t total = base.layout.total();
+
+  std::normal_distribution<float> noise;
+  std::vector<std::complex<float>> source(total + delay), signal1(total), signal2(total);
+  for (auto &v : source)
+    v = std::complex<float>(noise(gen), noise(gen));
+  for (size_t i = 0; i < total; ++i)
+  {
+    signal1[i] = source[i] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+    signal2[i] = source[i + delay] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+  }
+  const double rx_distance_diff = 300.0, rx_distance = 5000.0;
+
+  SweepGrid grid;
+  grid.bandwidth_khz = {0, 400};
+  grid.corr_type = {CORR_ABS, CORR_DPHASE};
+  grid.smoothing = {0, 5};
+  grid.interpol = {0, 10};
+
+  int failed = 0, cases = 0;
+  for (int variant = 0; variant < 3; ++variant)
+  {
+    Tdoa2Config config = base;
+    config.corr_mode = variant == 1 ? CORR_MODE_COARSE_FINE : CORR_MODE_FULL;
+    config.corr_segment_len = variant == 2 ? 4096 : 0;
+
+    std::vector<SweepPoint> points;
+    SweepStats stats;
+    if (tdoa2_sweep(signal1, signal2, rx_distance_diff, rx_distance, config, grid, points, stats))
+      return 1;
+
+    Tdoa2 tdoa2(config);
+    for (const SweepPoint &point : points)
+    {
+      // Tdoa2::run reports every stage, only the comparison is printed
+      std::ostringstream sink;
+      std::streambuf *cout_buf = std::cout.rdbuf(sink.rdbuf());
+      tdoa2.set_config(point.config);
+      Tdoa2Result result;
+      bool ok = tdoa2.run(signal1, signal2, rx_distance_diff, rx_distance, result) == 0;
+      std::cout.rdbuf(cout_buf);
+
+      // the sweep smooths a wider raw window, the sums agree to rounding precision
+      ++cases;
+      if (!ok || !point.ok || std::fabs(result.doa_samples - point.result.doa_samples) > 1e-6 ||
+          std::fabs(result.reliability - point.result.reliability) > 1e-6)
+      {
+        if (failed++ < 5)
+          std::cout << "tdoa2_sweep variant " << variant << " bw " << point.config.signal_bandwidth_khz << " corr "
+                    << point.config.corr_type << " smoothing " << point.config.smoothing_factor << " interpol "
+                    << point.config.interpol << ": " << point.result.doa_samples << " != " << result.doa_samples
+                    << std::endl;
+      }
+    }
+  }
+  std::cout << "tdoa2_sweep vs Tdoa2::run: " << cases - failed << "/" << cases << " equal" << std::endl;
+  return failed ? 1 : 0;
+}
+
+// noise-like source (dab = false) or a DAB mode I like one at 2 Msps: 96 ms frames of a null symbol and
+// 76 noise symbols with a cyclic prefix
+static void ref_source(std::mt19937 &gen, bool dab, std::vector<std::complex<float>> &source)
+{
+  std::normal_distribution<float> noise;
+  for (auto &v : source)
+    v = dab ? std::complex<float>() : std::complex<float>(noise(gen), noise(gen));
+  if (!dab)
+    return;
+  const size_t frame = 192000, tu = 2000, tg = 492;
+  const double null_len = 2593.75, symbol = 2492.1875;
+  std::vector<std::complex<float>> useful(tu);
+  for (size_t f = 0; f < source.size(); f += frame)
+    for (int j = 0; j < 76; ++j)
+    {
+      for (auto &v : useful)
+        v = std::complex<float>(noise(gen), noise(gen));
+      size_t start = f + static_cast<size_t>(std::lround(null_len + j * symbol));
+      for (size_t k = 0; k < tu + tg && start + k < source.size(); ++k)
+        source[start + k] = useful[(k + tu - tg) % tu];
+    }
+}
+
+static int check_ref_corr(std::mt19937 &gen)
+{
+  // rx2 earlier by a known delay, independent noise
+  const long delay = -37;
+  std::normal_distribution<float> noise;
+  int failed = 0, cases = 0;
+  for (bool dab : {false, true})
+  {
+    const size_t n = dab ? 400000 : 200000;
+    std::vector<std::complex<float>> source(n + 64), signal1(n), signal2(n);
+    ref_source(gen, dab, source);
+    for (size_t i = 0; i < n; ++i)
+    {
+      signal1[i] = source[i + 64 + delay] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+      signal2[i] = source[i + 64] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+    }
+
+    for (CorrType corr_type : {CORR_ABS, CORR_DPHASE})
+    {
+      PreparedIQ a, b;
+      if (prepare_iq(signal1, corr_type, a) || prepare_iq(signal2, corr_type, b))
+        return 1;
+      for (CorrMode mode : {CORR_MODE_COARSE_FINE, CORR_MODE_DAB})
+        for (int smoothing : {0, 12, 200})
+        {
+          if (mode == CORR_MODE_DAB && !dab)
+            continue;
+          Tdoa2Config config;
+          config.corr_type = corr_type;
+          config.smoothing_factor_ref = smoothing;
+          config.report = false;
+          RefCorr full;
+          if (tdoa2_ref_corr(a, b, config, full))
+            return 1;
+
+          config.corr_mode = mode;
+          RefCorr window;
+          if (tdoa2_ref_corr(a, b, config, window, signal1, signal2))
+            return 1;
+
+          // same maximum, the reliability of the window never claims more than the full correlation,
+          // the DAB timing must have found the frames
+          ++cases;
+          long idx_full = full.idx_offset + static_cast<long>(full.idx);
+          long idx_window = window.idx_offset + static_cast<long>(window.idx);
+          if (idx_window != idx_full || !(window.reliability <= full.reliability + 1e-9) ||
+              (mode == CORR_MODE_DAB && window.corr.size() >= full.corr.size()))
+          {
+            if (failed++ < 5)
+              std::cout << (mode == CORR_MODE_DAB ? "dab" : "coarse-fine") << " corr " << corr_type << " smoothing "
+                        << smoothing << ": index " << idx_window << " reliability " << window.reliability
+                        << " != " << idx_full << " " << full.reliability << std::endl;
+          }
+        }
+    }
+  }
+  std::cout << "coarse-fine and dab vs full reference correlation: " << cases - failed << "/" << cases << " equal"
+            << std::endl;
+  return failed ? 1 : 0;
+}
+
+static int check_corr_modes(std::mt19937 &gen)
+{
+  // a DAB like capture (ref_source), rx2 earlier by a known delay, independent noise
+  Tdoa2Config base;
+  base.layout.samples_per_freq = 300000;
+  base.layout.samples_per_slice = 240000;
+  base.layout.guard_interval = 40000;
+  base.report = false;
+  const long delay = 37;
+  const size_t total = base.layout.total();
+
+  std::normal_distribution<float> noise;
+  std::vector<std::complex<float>> source(total + delay), signal1(total), signal2(total);
+  ref_source(gen, true, source);
+  for (size_t i = 0; i < total; ++i)
+  {
+    signal1[i] = source[i] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+    signal2[i] = source[i + delay] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+  }
+  const double rx_distance_diff = 300.0, rx_distance = 5000.0;
+
+  // Tdoa2::run reports every stage, only the comparison is printed
+  auto run = [&](const Tdoa2Config &config, Tdoa2Result &result)
+  {
+    std::ostringstream sink;
+    std::streambuf *cout_buf = std::cout.rdbuf(sink.rdbuf());
+    bool ok = Tdoa2(config).run(signal1, signal2, rx_distance_diff, rx_distance, result) == 0;
+    std::cout.rdbuf(cout_buf);
+    return ok;
+  };
+
+  int failed = 0, cases = 0;
+  for (CorrType corr_type : {CORR_ABS, CORR_DPHASE})
+    for (int smoothing : {0, 12, 200})
+      for (int interpol : {0, 10})
+      {
+        Tdoa2Config config = base;
+        config.corr_type = corr_type;
+        config.smoothing_factor_ref = smoothing;
+        config.interpol = interpol;
+        Tdoa2Result full;
+        bool ok = run(config, full);
+        for (CorrMode mode : {CORR_MODE_COARSE_FINE, CORR_MODE_DAB})
+        {
+          config.corr_mode = mode;
+          Tdoa2Result result;
+          ok = run(config, result) && ok;
+
+          // same delays and measurement, the reference reliabilities never above the full ones
+          ++cases;
+          if (!ok || std::fabs(result.doa_samples - full.doa_samples) > 1e-6 ||
+              std::fabs(result.delay1 - full.delay1) > 1e-6 || std::fabs(result.delay3 - full.delay3) > 1e-6 ||
+              result.reliability2 != full.reliability2 || !(result.reliability1 <= full.reliability1 + 1e-9) ||
+              !(result.reliability3 <= full.reliability3 + 1e-9))
+          {
+            if (failed++ < 5)
+              std::cout << "Tdoa2::run " << (mode == CORR_MODE_DAB ? "dab" : "coarse-fine") << " corr " << corr_type
+                        << " smoothing " << smoothing << " interpol " << interpol << ": " << result.doa_samples
+                        << " != " << full.doa_samples << std::endl;
+          }
+        }
+      }
+  std::cout << "Tdoa2::run coarse-fine and dab vs full: " << cases - failed << "/" << cases << " equal" << std::endl;
+  return failed ? 1 : 0;
+}
+
+static int check_resample(std::mt19937 &gen)
+{
+  // rx2 samples a smooth source 20 ppm fast, the TDOA of the measurement is 0
+  Tdoa2Config config;
+  config.layout.samples_per_freq = 300000;
+  config.layout.samples_per_slice = 240000;
+  config.layout.guard_interval = 40000;
+  config.report = false;
+  config.interpol = 10;
+  config.max_drift_ppm = 50.0;
+  config.drift_compensation = DRIFT_RESAMPLE;
+  const size_t total = config.layout.total();
+
+  std::normal_distribution<float> noise;
+  std::vector<std::complex<float>> white(total + 1000), source(total + 1000), signal1, signal2;
+  for (auto &v : white)
+    v = std::complex<float>(noise(gen), noise(gen));
+  for (size_t i = 3; i < source.size(); ++i)
+    source[i] = white[i] + white[i - 1] + white[i - 2] + white[i - 3];
+  signal1.assign(source.begin() + 50, source.begin() + 50 + static_cast<long>(total));
+  if (resample_iq(source, 1.0 + 20e-6, 100.0, signal2))
+    return 1;
+  signal2.resize(total);
+  for (size_t i = 0; i < total; ++i)
+  {
+    signal1[i] += 0.3f * std::complex<float>(noise(gen), noise(gen));
+    signal2[i] += 0.3f * std::complex<float>(noise(gen), noise(gen));
+  }
+
+  int failed = 0, cases = 0;
+  for (CorrType corr_type : {CORR_ABS, CORR_DPHASE})
+  {
+    config.corr_type = corr_type;
+    Tdoa2Result result;
+    std::ostringstream sink;
+    std::streambuf *cout_buf = std::cout.rdbuf(sink.rdbuf());
+    bool ok = Tdoa2(config).run(signal1, signal2, 0.0, 5000.0, result) == 0;
+    std::cout.rdbuf(cout_buf);
+
+    std::vector<RxPairJob> jobs(1);
+    jobs[0].rx1 = 0;
+    jobs[0].rx2 = 1;
+    jobs[0].rx_distance_diff = 0.0;
+    jobs[0].rx_distance = 5000.0;
+    ok = tdoa2_pairs({signal1, signal2}, config, jobs) == 0 && jobs[0].ok && ok;
+
+    // both engines resample alike, the drift no longer smears the measurement peak
+    ++cases;
+    if (!ok || jobs[0].result.doa_samples != result.doa_samples || std::fabs(result.doa_samples) > 0.5)
+    {
+      if (failed++ < 5)
+        std::cout << "resample corr " << corr_type << ": tdoa2_pairs " << jobs[0].result.doa_samples
+                  << ", Tdoa2::run " << result.doa_samples << std::endl;
+    }
+  }
+  std::cout << "resampled measurement, tdoa2_pairs vs Tdoa2::run: " << cases - failed << "/" << cases << " equal"
+            << std::endl;
+  return failed ? 1 : 0;
+}
+
+static int check_matched(std::mt19937 &gen)
+{
+  // common noise reference, a template burst in the measurement slice 23 samples later at rx1
+  Tdoa2Config config;
+  config.layout.samples_per_freq = 300000;
+  config.layout.samples_per_slice = 240000;
+  config.layout.guard_interval = 40000;
+  config.report = false;
+  const long delay = 23;
+  const size_t total = config.layout.total();
+
+  std::normal_distribution<float> noise;
+  std::vector<std::complex<float>> burst(4096), source(total), signal1(total), signal2(total);
+  for (auto &v : burst)
+    v = std::complex<float>(noise(gen), noise(gen));
+  ref_source(gen, false, source);
+  for (size_t i = 0; i < total; ++i)
+  {
+    signal1[i] = source[i] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+    signal2[i] = source[i] + 0.5f * std::complex<float>(noise(gen), noise(gen));
+  }
+  size_t start = config.layout.slice_start(1) + 100000;
+  for (size_t k = 0; k < burst.size(); ++k)
+  {
+    signal1[start + delay + k] += 2.0f * burst[k];
+    signal2[start + k] += 2.0f * burst[k];
+  }
+  TemplateCache cache(burst);
+  config.measure_template = &cache;
+
+  int failed = 0, cases = 0;
+  for (int interpol : {0, 10})
+  {
+    config.interpol = interpol;
+    Tdoa2Result result;
+    std::ostringstream sink;
+    std::streambuf *cout_buf = std::cout.rdbuf(sink.rdbuf());
+    bool ok = Tdoa2(config).run(signal1, signal2, 0.0, 5000.0, result) == 0;
+    std::cout.rdbuf(cout_buf);
+
+    std::vector<RxPairJob> jobs(1);
+    jobs[0].rx1 = 0;
+    jobs[0].rx2 = 1;
+    jobs[0].rx_distance_diff = 0.0;
+    jobs[0].rx_distance = 5000.0;
+    ok = tdoa2_pairs({signal1, signal2}, config, jobs) == 0 && jobs[0].ok && ok;
+
+    // per receiver arrivals of tdoa2_pairs and the pair delay of Tdoa2::run are the same measurement
+    ++cases;
+    if (!ok || jobs[0].result.doa_samples != result.doa_samples || result.reliability2 != jobs[0].result.reliability2 ||
+        std::fabs(result.doa_samples - static_cast<double>(delay)) > 0.1)
+    {
+      if (failed++ < 5)
+        std::cout << "matched filter interpol " << interpol << ": tdoa2_pairs " << jobs[0].result.doa_samples
+                  << ", Tdoa2::run " << result.doa_samples << std::endl;
+    }
+  }
+  std::cout << "matched filter measurement, tdoa2_pairs vs Tdoa2::run: " << cases - failed << "/" << cases << " equal"
+            << std::endl;
+  return failed ? 1 : 0;
+}
+
+int main()
+{
+  std::mt19937 gen(2017);
+  int failed = check_reliability(gen);
+  failed += check_ifft_window(gen);
+  failed += check_sweep(gen);
+  failed += check_ref_corr(gen);
+  failed += check_corr_modes(gen);
+  failed += check_resample(gen);
+  failed += check_matched(gen);
+  std::cout << (failed ? "CHECK FAILED" : "all checks passed") << std::endl;
+  return failed ? 1 : 0;
+}
@@ -1,10 +1,127 @@
 #include <iostream>
-#include "../lib/ReadIQ.hpp"
+#include <vector>
+#include <complex>
+#include <chrono>
+#include <sys/resource.h>
+#include "../lib/Config.h"
+#include "../lib/Capture.h"
+#include "../lib/Trace.h"
 
-int main()
+// correlation results of the pairs and the heatmap maximum
+static void print_results(const Capture &capture)
 {
-  std::cout << "Hello w" << std::endl;
+  for (const RxPairJob &job : capture.pairs)
+  {
+    std::cout << std::endl << "CORRELATION " << job.rx1 + 1 << " & " << job.rx2 + 1 << std::endl;
+    if (!job.ok)
+    {
+      std::cout << "correlation failed, pair not used for the heatmap" << std::endl;
+      continue;
+    }
+    const Tdoa2Result &r = job.result;
+    std::cout << "raw delay1 (ref): " << r.delay1 << ", reliability: " << r.reliability1 << std::endl;
+    std::cout << "raw delay2 (measure): " << r.delay2 << ", reliability: " << r.reliability2 << std::endl;
+    std::cout << "raw delay3 (ref check): " << r.delay3 << ", reliability: " << r.reliability3 << std::endl;
+    std::cout << "merged delay of ref and ref check: " << r.ref_delay << ", clock drift: " << r.drift_ppm << " ppm" << std::endl;
+    std::cout << "TDOA in samples: " << r.doa_samples << "(how much is signal" << job.rx1 + 1 << " later than signal"
+              << job.rx2 + 1 << ")" << std::endl;
+    std::cout << "TDOA in distance [m]: " << r.doa_meters << std::endl;
+    std::cout << "Total Reliability (min of all 3): " << r.reliability << std::endl;
+  }
+  std::cout << std::endl;
+  if (capture.located)
+    std::cout << "heatmap maximum: lat=" << capture.heatmap.peak.lat << ", long=" << capture.heatmap.peak.lon << std::endl;
+  std::cout << std::endl;
+}
+
+// memory_budget_mb > 0: the budgeted engine on this thread, no pool and no result cache
+static int run_budgeted(const TdoaConfig &config)
+{
+  MemoryBudget budget(config.memory_budget_mb * 1024 * 1024);
+  BudgetPlan plan;
+  Capture capture;
+  capture.id = config.file_identifier;
+  std::cout << "READ DATA FROM FILES (memory budget " << config.memory_budget_mb << " MB)" << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  int failed = capture_run_budgeted(config, capture, true, budget, plan);
+  auto stop = std::chrono::steady_clock::now();
+  if (!config.trace_file.empty())
+    trace_write(config.trace_file);
+  if (failed)
+    return 1;
+
+  print_results(capture);
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  std::cout << "memory plan: " << (plan.strategy == BUDGET_RESIDENT ? "resident" : "streamed") << ", fft blocks "
+            << plan.ref_fft_len << " / " << plan.measure_fft_len << ", estimate " << plan.estimate / 1024 << " KB" << std::endl;
+  std::cout << "tracked peak: " << budget.peak() / 1024 << " KB of " << budget.limit() / 1024
+            << " KB, max rss: " << usage.ru_maxrss << " KB" << std::endl;
+  std::cout << "processing time (" << capture.pairs.size() << " pairs, 1 thread): "
+            << std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
+  return 0;
+}
+
+// evaluation_main.m for any number of receivers: TDOA of the configured RX pairs of one capture and the heatmap
+int main(int argc, char *argv[])
+{
+  if (argc < 2 || argc > 3)
+  {
+    std::cerr << "usage: " << argv[0] << " <config.ini | config.m> [file_identifier]" << std::endl;
+    return 1;
+  }
+
+  TdoaConfig config;
+  if (load_config(argv[1], config))
+    return 1;
+  if (argc == 3)
+  {
+    std::cout << "Overriding config file_identifier with: " << argv[2] << std::endl;
+    config.file_identifier = argv[2];
+  }
+  if (config.rx.size() < 2)
+  {
+    std::cerr << "Error: at least two receivers are needed!" << std::endl;
+    return 1;
+  }
+
+  LatLong geo_ref = config.geo_ref();
+  std::cout << "geodetic reference point (mean of RX positions): lat=" << geo_ref.lat << ", long=" << geo_ref.lon << std::endl;
+
+  trace_enable(!config.trace_file.empty());
+  trace_thread_name("main");
+  if (config.memory_budget_mb > 0)
+    return run_budgeted(config);
+
+  ResultCache cache;
+  if (!config.cache_dir.empty() && cache.open(config.cache_dir))
+    return 1;
+
+  // task graph: read per receiver -> slices and reference spectrum per receiver -> pairs -> heatmap
+  // (only the pairs that are not in the result cache)
+  ThreadPool pool;
+  TaskGraph graph;
+  Capture capture;
+  capture.id = config.file_identifier;
+  TaskGraph::TaskId heatmap_task;
+  std::cout << "READ DATA FROM FILES" << std::endl;
+  auto start = std::chrono::steady_clock::now();
+  if (capture_tasks(graph, config, capture, true, heatmap_task, cache.is_open() ? &cache : nullptr))
+    return 1;
+  int failed = graph.run(pool);
+  auto stop = std::chrono::steady_clock::now();
+  if (!config.trace_file.empty())
+    trace_write(config.trace_file);
+  if (failed)
+    return 1;
 
-  ReadIQ("../../TDOA-MATHLAB/recorded_data/1_1000_1031_2024_5_18_11_30.dat");
+  print_results(capture);
+  if (config.report_level > 0)
+    graph.print_timings();
+  if (cache.is_open())
+    std::cout << "result cache: " << cache.hits() << " hits, " << cache.misses() << " misses"
+              << (capture.fix_cached ? " (fix from the cache)" : "") << std::endl;
+  std::cout << "processing time (" << capture.pairs.size() << " pairs, " << pool.size() << " threads): "
+            << std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
   return 0;
 }
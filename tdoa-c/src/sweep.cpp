@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <complex>
+#include <chrono>
+#include "../lib/ReadIQ.h"
+#include "../lib/Config.h"
+#include "../lib/Sweep.h"
+
+// parameter sweep of tdoa2 on one capture (all RX pairs), e.g. the smoothing 0/12/200/400 runs of
+// TDOA-MATHLAB/result in one pass: sweep config.ini 400,0 dphase 0,12,200,400 0,10
+
+static bool parse_list(const std::string &arg, std::vector<std::string> &items)
+{
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      items.push_back(item);
+  return !items.empty();
+}
+
+static bool parse_ints(const std::string &arg, std::vector<int> &values)
+{
+  std::vector<std::string> items;
+  if (!parse_list(arg, items))
+    return false;
+  for (const std::string &item : items)
+  {
+    char *end;
+    long v = std::strtol(item.c_str(), &end, 10);
+    if (*end != '\0' || v < 0)
+      return false;
+    values.push_back(static_cast<int>(v));
+  }
+  return true;
+}
+
+static bool parse_corr_types(const std::string &arg, std::vector<CorrType> &values)
+{
+  std::vector<std::string> items;
+  if (!parse_list(arg, items))
+    return false;
+  for (const std::string &item : items)
+  {
+    if (item != "abs" && item != "dphase")
+      return false;
+    values.push_back(item == "abs" ? CORR_ABS : CORR_DPHASE);
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  SweepGrid grid;
+  if (argc < 6 || argc > 7 || !parse_ints(argv[2], grid.bandwidth_khz) || !parse_corr_types(argv[3], grid.corr_type) ||
+      !parse_ints(argv[4], grid.smoothing) || !parse_ints(argv[5], grid.interpol))
+  {
+    std::cerr << "usage: " << argv[0] << " <config.ini | config.m> <bandwidths_khz> <corr_types> <smoothing_factors>"
+              << " <interpol_factors> [num_threads]" << std::endl;
+    std::cerr << "       lists are comma separated, e.g. 400,0 abs,dphase 0,12,200,400 0,10" << std::endl;
+    return 1;
+  }
+  unsigned num_threads = argc == 7 ? static_cast<unsigned>(std::atoi(argv[6])) : 0;
+
+  TdoaConfig config;
+  if (load_config(argv[1], config))
+    return 1;
+  if (config.rx.size() < 2)
+  {
+    std::cerr << "Error: at least two receivers are needed!" << std::endl;
+    return 1;
+  }
+  LatLong geo_ref = config.geo_ref();
+
+  std::cout << "READ DATA FROM FILES" << std::endl;
+  std::vector<std::vector<std::complex<float>>> signals(config.rx.size());
+  for (size_t rx = 0; rx < config.rx.size(); ++rx)
+    if (ReadIQ(config.rx_file(rx), signals[rx]))
+      return 1;
+
+  auto start = std::chrono::steady_clock::now();
+  size_t computed = 0, reused = 0;
+  for (size_t i = 0; i < config.rx.size(); ++i)
+    for (size_t j = i + 1; j < config.rx.size(); ++j)
+    {
+      double rx_distance_diff = dist_latlong(config.tx_ref, config.rx[i], geo_ref) - dist_latlong(config.tx_ref, config.rx[j], geo_ref);
+      double rx_distance = dist_latlong(config.rx[i], config.rx[j], geo_ref);
+
+      std::vector<SweepPoint> points;
+      SweepStats stats;
+      if (tdoa2_sweep(signals[i], signals[j], rx_distance_diff, rx_distance, config.tdoa2_config(), grid, points,
+                      stats, num_threads))
+        return 1;
+      computed += stats.computed;
+      reused += stats.reused;
+
+      std::cout << std::endl << "SWEEP " << i + 1 << " & " << j + 1 << std::endl;
+      std::cout << "bw_khz  corr    smoothing  interpol  tdoa_samples  tdoa_m    reliability" << std::endl;
+      for (const SweepPoint &p : points)
+      {
+        std::cout << std::left << std::setw(8) << p.config.signal_bandwidth_khz << std::setw(8)
+                  << (p.config.corr_type == CORR_ABS ? "abs" : "dphase") << std::setw(11) << p.config.smoothing_factor
+                  << std::setw(10) << p.config.interpol;
+        if (p.ok)
+          std::cout << std::setw(14) << p.result.doa_samples << std::setw(10) << p.result.doa_meters
+                    << p.result.reliability << std::endl;
+        else
+          std::cout << "failed" << std::endl;
+        std::cout << std::right;
+      }
+    }
+  auto stop = std::chrono::steady_clock::now();
+
+  std::cout << std::endl << "stage results computed: " << computed << ", reused: " << reused << std::endl;
+  std::cout << "sweep processing time: " << std::chrono::duration<double>(stop - start).count() << " s" << std::endl;
+  return 0;
+}
@@ -0,0 +1,280 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include "../lib/Config.h"
+#include "../lib/Capture.h"
+#include "../lib/Trace.h"
+
+// tdoa-watch: daemon that processes captures as soon as the files of all receivers have landed
+// a file <rx>_<id> counts as complete when its writer closed it (or it was moved in) with the size of
+// a full capture, then the capture runs on a pool that stays up between captures, with warm fft plans
+// and the buffers of the previous capture (with memory_budget_mb: the budgeted engine instead, see BudgetPairs.h)
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  // receiver sets older than this are dropped (captures arrive every 2 minutes)
+  const auto STALE_AFTER = std::chrono::minutes(10);
+
+  std::atomic<bool> stop_requested{false};
+
+  void on_signal(int)
+  {
+    stop_requested = true;
+  }
+
+  struct Ready
+  {
+    std::string id;
+    Clock::time_point last_file; // event time of the last receiver file
+  };
+
+  struct Pending
+  {
+    std::set<size_t> complete;
+    Clock::time_point first_file;
+  };
+}
+
+int main(int argc, char *argv[])
+{
+  if (argc < 3 || argc > 4)
+  {
+    std::cerr << "usage: " << argv[0] << " <config.ini | config.m> <directory> [results.csv]" << std::endl;
+    return 1;
+  }
+
+  TdoaConfig config;
+  if (load_config(argv[1], config))
+    return 1;
+  if (config.rx.size() < 2)
+  {
+    std::cerr << "Error: at least two receivers are needed!" << std::endl;
+    return 1;
+  }
+  std::string dir = argv[2];
+  config.folder_identifier = dir.back() == '/' ? dir : dir + "/";
+  const size_t num_rx = config.rx.size();
+  const off_t expected_bytes = static_cast<off_t>(2 * config.layout.total()); // 8 bit I and Q
+
+  std::vector<RxPairJob> pair_list;
+  if (capture_pair_jobs(config, pair_list))
+    return 1;
+
+  // results are appended, the header only goes into a new file
+  std::ofstream out_file;
+  if (argc == 4)
+  {
+    struct stat st;
+    bool is_new = stat(argv[3], &st) != 0 || st.st_size == 0;
+    out_file.open(argv[3], std::ios::app);
+    if (!out_file.is_open())
+    {
+      std::cerr << "Error: " << argv[3] << " cannot be written!" << std::endl;
+      return 1;
+    }
+    if (is_new)
+      capture_write_header(out_file, pair_list);
+  }
+
+  int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+  {
+    std::cerr << "Error: cannot watch " << dir << ": " << std::strerror(errno) << std::endl;
+    return 1;
+  }
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+
+  // memory_budget_mb > 0: the budgeted engine on the processing thread, no pool and no result cache
+  const bool budgeted = config.memory_budget_mb > 0;
+  ResultCache cache;
+  if (!budgeted && !config.cache_dir.empty() && cache.open(config.cache_dir))
+    return 1;
+  trace_enable(!config.trace_file.empty());
+
+  // warm pool and fft plans before the first capture
+  std::unique_ptr<ThreadPool> pool;
+  MemoryBudget budget(config.memory_budget_mb * 1024 * 1024);
+  if (!budgeted)
+  {
+    pool = std::make_unique<ThreadPool>();
+    tdoa2_warm_up(config.tdoa2_config());
+  }
+
+  std::mutex mutex;
+  std::condition_variable ready_cv;
+  std::deque<Ready> ready;
+  bool done = false;
+
+  // processing thread, one capture at a time on the pool
+  std::thread processor([&]()
+  {
+    Capture capture;
+    trace_thread_name("processor");
+    while (true)
+    {
+      Ready next;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        ready_cv.wait(lock, [&]() { return done || !ready.empty(); });
+        if (ready.empty())
+          return;
+        next = ready.front();
+        ready.pop_front();
+      }
+
+      auto start = Clock::now();
+      capture.id = next.id;
+      bool ok;
+      if (budgeted)
+      {
+        BudgetPlan plan;
+        ok = capture_run_budgeted(config, capture, false, budget, plan) == 0;
+      }
+      else
+      {
+        TaskGraph graph;
+        TaskGraph::TaskId last;
+        ok = capture_tasks(graph, config, capture, false, last, cache.is_open() ? &cache : nullptr) == 0 && graph.run(*pool) == 0;
+      }
+      auto stop = Clock::now();
+      trace_event(("capture " + capture.id).c_str(), "capture", start, stop);
+
+      std::cout << capture.id << ": " << (!ok ? "failed" : capture.located ? "fix" : "no fix")
+                << (capture.fix_cached ? " (cached)" : "");
+      if (ok && capture.located)
+        std::cout << " lat=" << capture.heatmap.peak.lat << ", long=" << capture.heatmap.peak.lon;
+      std::cout << ", latency " << std::chrono::duration<double, std::milli>(stop - next.last_file).count()
+                << " ms (processing " << std::chrono::duration<double, std::milli>(stop - start).count() << " ms)"
+                << std::endl;
+      if (out_file.is_open())
+        capture_write_record(out_file, capture, ok);
+    }
+  });
+
+  std::cout << "watching " << dir << " for " << num_rx << " receiver files of " << expected_bytes << " bytes" << std::endl;
+  std::map<std::string, Pending> pending;
+  std::map<std::string, Clock::time_point> queued; // ids handed to the processor within STALE_AFTER
+
+  // a receiver file <rx>_<id> is complete, queues the capture once every receiver has one
+  // rescan: from a directory rescan, files of captures already queued are skipped
+  auto file_landed = [&](const std::string &name, Clock::time_point now, bool rescan)
+  {
+    size_t rx;
+    std::string id;
+    if (!parse_rx_file_name(name, rx, id) || rx < 1 || rx > num_rx || (rescan && queued.count(id)))
+      return;
+
+    struct stat st;
+    if (stat((config.folder_identifier + name).c_str(), &st) != 0)
+      return;
+    if (st.st_size != expected_bytes)
+    {
+      if (!rescan)
+        std::cout << name << ": ignored, " << st.st_size << " bytes" << std::endl;
+      return;
+    }
+    // a rescan only picks up files that are recent enough to complete a capture
+    if (rescan && std::chrono::system_clock::now() - std::chrono::system_clock::from_time_t(st.st_mtime) > STALE_AFTER)
+      return;
+
+    auto found = pending.find(id);
+    if (found == pending.end())
+      found = pending.emplace(id, Pending{{}, now}).first;
+    found->second.complete.insert(rx);
+    if (found->second.complete.size() == num_rx)
+    {
+      pending.erase(found);
+      queued[id] = now;
+      std::lock_guard<std::mutex> lock(mutex);
+      ready.push_back({id, Clock::now()});
+      ready_cv.notify_one();
+    }
+  };
+
+  alignas(inotify_event) char buffer[64 * 1024];
+  while (!stop_requested)
+  {
+    pollfd pfd = {fd, POLLIN, 0};
+    int n = poll(&pfd, 1, 200);
+    if (n < 0 && errno != EINTR)
+    {
+      std::cerr << "Error: poll: " << std::strerror(errno) << std::endl;
+      break;
+    }
+
+    auto now = Clock::now();
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+      if (now - it->second.first_file > STALE_AFTER)
+      {
+        std::cout << it->first << ": dropped, only " << it->second.complete.size() << " of " << num_rx
+                  << " receiver files arrived" << std::endl;
+        it = pending.erase(it);
+      }
+      else
+        ++it;
+    }
+    for (auto it = queued.begin(); it != queued.end();)
+      it = now - it->second > STALE_AFTER ? queued.erase(it) : std::next(it);
+    if (n <= 0)
+      continue;
+
+    ssize_t len;
+    while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+      for (char *p = buffer; p < buffer + len;)
+      {
+        const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+        p += sizeof(inotify_event) + event->len;
+        if (event->mask & IN_Q_OVERFLOW)
+        {
+          // events were lost, the directory tells which receiver files are there
+          std::cout << "inotify queue overflow, rescanning " << dir << std::endl;
+          std::error_code ec;
+          for (const auto &entry : std::filesystem::directory_iterator(dir, ec))
+            if (entry.is_regular_file())
+              file_landed(entry.path().filename().string(), now, true);
+          if (ec)
+            std::cerr << "Error: directory " << dir << " cannot be read: " << ec.message() << std::endl;
+          continue;
+        }
+        if (event->len == 0 || (event->mask & IN_ISDIR))
+          continue;
+        file_landed(event->name, now, false);
+      }
+    }
+  }
+
+  std::cout << "stopping, finishing queued captures" << std::endl;
+  close(fd);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+  }
+  ready_cv.notify_one();
+  processor.join();
+  if (!config.trace_file.empty() && trace_write(config.trace_file) == 0)
+    std::cout << "trace written to " << config.trace_file << std::endl;
+  return 0;
+}